@@ -0,0 +1,293 @@
+#include <iostream>
+#include <string>
+#include <random>
+#include <cstdint>
+#include <cstdlib>
+#include <cerrno>
+#include <cctype>
+#include <cmath>
+#include <omp.h>
+
+#include "mpi.h"
+
+#include "definitions/constants.h"
+#include "data_structures/Grid.h"
+#include "data_structures/DistributedGrid.h"
+
+/*
+ * Headless simulation: run a given number of steps of Grid::update_all_boids without any visualization and
+ * report the throughput and the time spent in each phase as JSON on the standard output.
+ *
+ * When launched on several MPI processes, the boids are shared between the processes with a DistributedGrid. The
+ * reported phase timings are then the maximum over the processes, and the blocks are rebalanced between the
+ * processes when the imbalance of their costs exceeds the --imbalance threshold ("inf" never rebalances).
+ *
+ * Usage: simulation [--boids N] [--steps N] [--dimension 2|3] [--search naive|cell_list|octree]
+ *                   [--kernel scalar|simd] [--seed N] [--imbalance X]
+ */
+
+/**
+ * Parameters of a simulation, read from the command line.
+ */
+struct SimulationParameters {
+    std::size_t     number_of_boids{10000};
+    std::size_t     number_of_steps{100};
+    std::size_t     dimension{3};
+    NeighbourSearch neighbour_search{NeighbourSearch::CELL_LIST};
+    ForceKernel     force_kernel{ForceKernel::SIMD};
+    std::uint64_t   seed{constants::DEFAULT_SEED};
+    double          imbalance_threshold{1.1};
+};
+
+std::string to_string(NeighbourSearch neighbour_search) {
+    switch(neighbour_search) {
+        case NeighbourSearch::CELL_LIST: return "cell_list";
+        case NeighbourSearch::OCTREE:    return "octree";
+        case NeighbourSearch::NAIVE:
+        default:                         return "naive";
+    }
+}
+
+std::string to_string(ForceKernel force_kernel) {
+    return force_kernel == ForceKernel::SIMD ? "simd" : "scalar";
+}
+
+void print_usage(char const * program_name) {
+    std::cerr << "Usage: " << program_name << " [--boids N] [--steps N] [--dimension 2|3]"
+              << " [--search naive|cell_list|octree] [--kernel scalar|simd] [--seed N] [--imbalance X]" << std::endl;
+}
+
+/**
+ * Read an unsigned integer from a command-line value.
+ * @param value  the value, which should contain only decimal digits.
+ * @param result the integer read, left unchanged if the value is invalid.
+ * @return true if the value is a valid integer representable in an unsigned long long, false otherwise.
+ */
+bool parse_unsigned(std::string const & value, unsigned long long & result) {
+    if(value.empty() || !std::isdigit(static_cast<unsigned char>(value.front())))
+        return false;
+    char * end;
+    errno = 0;
+    unsigned long long const parsed{std::strtoull(value.c_str(), &end, 10)};
+    if(errno == ERANGE || *end != '\0')
+        return false;
+    result = parsed;
+    return true;
+}
+
+/**
+ * Read a floating-point number from a command-line value.
+ * @param value  the value.
+ * @param result the number read, left unchanged if the value is invalid.
+ * @return true if the whole value is a finite number, false otherwise.
+ */
+bool parse_double(std::string const & value, double & result) {
+    if(value.empty() || std::isspace(static_cast<unsigned char>(value.front())))
+        return false;
+    char * end;
+    errno = 0;
+    double const parsed{std::strtod(value.c_str(), &end)};
+    if(errno == ERANGE || *end != '\0' || !std::isfinite(parsed))
+        return false;
+    result = parsed;
+    return true;
+}
+
+/**
+ * Read the parameters of the simulation from the command line.
+ * @param argc       number of arguments.
+ * @param argv       the arguments.
+ * @param parameters the parameters read. Parameters absent from the command line keep their value.
+ * @return true if the command line is valid, false otherwise.
+ */
+bool parse_parameters(int argc, char ** argv, SimulationParameters & parameters) {
+    for(int i{1}; i < argc; ++i) {
+        std::string const option{argv[i]};
+        if(i + 1 >= argc)
+            return false;
+        std::string const value{argv[++i]};
+
+        unsigned long long integer;
+        if(option == "--boids") {
+            if(!parse_unsigned(value, integer) || integer == 0)
+                return false;
+            parameters.number_of_boids = integer;
+        }
+        else if(option == "--steps") {
+            if(!parse_unsigned(value, integer) || integer == 0)
+                return false;
+            parameters.number_of_steps = integer;
+        }
+        else if(option == "--dimension") {
+            if(!parse_unsigned(value, integer) || (integer != 2 && integer != 3))
+                return false;
+            parameters.dimension = integer;
+        }
+        else if(option == "--seed") {
+            if(!parse_unsigned(value, integer))
+                return false;
+            parameters.seed = integer;
+        }
+        else if(option == "--imbalance") {
+            if(!parse_double(value, parameters.imbalance_threshold) || parameters.imbalance_threshold <= 0.0)
+                return false;
+        }
+        else if(option == "--search" && value == "naive")
+            parameters.neighbour_search = NeighbourSearch::NAIVE;
+        else if(option == "--search" && value == "cell_list")
+            parameters.neighbour_search = NeighbourSearch::CELL_LIST;
+        else if(option == "--search" && value == "octree")
+            parameters.neighbour_search = NeighbourSearch::OCTREE;
+        else if(option == "--kernel" && value == "scalar")
+            parameters.force_kernel = ForceKernel::SCALAR;
+        else if(option == "--kernel" && value == "simd")
+            parameters.force_kernel = ForceKernel::SIMD;
+        else
+            return false;
+    }
+    return parameters.dimension == 2 || parameters.dimension == 3;
+}
+
+/**
+ * Measures of a simulation.
+ */
+struct SimulationReport {
+    int         processes{1};
+    double      initialisation_seconds{0.0};
+    double      simulation_seconds{0.0};
+    GridTimings timings;
+    double      migration_seconds{0.0};
+    double      ghost_exchange_seconds{0.0};
+    std::size_t rebalances{0};
+};
+
+/**
+ * Print the report of a simulation as JSON.
+ * @param parameters parameters of the simulation.
+ * @param report     measures of the simulation.
+ */
+void print_report(SimulationParameters const & parameters, SimulationReport const & report) {
+    double const steps_per_second{parameters.number_of_steps / report.simulation_seconds};
+    std::cout << "{" << std::endl
+              << "  \"dimension\": " << parameters.dimension << "," << std::endl
+              << "  \"boids\": " << parameters.number_of_boids << "," << std::endl
+              << "  \"steps\": " << parameters.number_of_steps << "," << std::endl
+              << "  \"neighbour_search\": \"" << to_string(parameters.neighbour_search) << "\"," << std::endl
+              << "  \"force_kernel\": \"" << to_string(parameters.force_kernel) << "\"," << std::endl
+              << "  \"seed\": " << parameters.seed << "," << std::endl
+              << "  \"processes\": " << report.processes << "," << std::endl
+              << "  \"threads\": " << omp_get_max_threads() << "," << std::endl
+              << "  \"rebalances\": " << report.rebalances << "," << std::endl
+              << "  \"initialisation_seconds\": " << report.initialisation_seconds << "," << std::endl
+              << "  \"simulation_seconds\": " << report.simulation_seconds << "," << std::endl
+              << "  \"steps_per_second\": " << steps_per_second << "," << std::endl
+              << "  \"boid_updates_per_second\": " << steps_per_second * parameters.number_of_boids << "," << std::endl
+              << "  \"phases_seconds\": {" << std::endl
+              << "    \"search_structure\": " << report.timings.search_structure << "," << std::endl
+              << "    \"structure_of_arrays\": " << report.timings.structure_of_arrays << "," << std::endl
+              << "    \"boid_update\": " << report.timings.boid_update << "," << std::endl
+              << "    \"migration\": " << report.migration_seconds << "," << std::endl
+              << "    \"ghost_exchange\": " << report.ghost_exchange_seconds << std::endl
+              << "  }" << std::endl
+              << "}" << std::endl;
+}
+
+/**
+ * Run the simulation on a single process and print its report.
+ * @tparam Dimension dimension of the simulated space.
+ * @param parameters parameters of the simulation.
+ */
+template <std::size_t Dimension>
+void run_simulation(SimulationParameters const & parameters) {
+    SimulationReport report;
+    double const start{omp_get_wtime()};
+    Grid<std::uniform_real_distribution<float>, Dimension> grid(parameters.number_of_boids,
+                                                                parameters.neighbour_search,
+                                                                parameters.force_kernel,
+                                                                parameters.seed);
+    double const initialisation_end{omp_get_wtime()};
+
+    for(std::size_t step{0}; step < parameters.number_of_steps; ++step) {
+        grid.update_all_boids();
+    }
+    report.simulation_seconds     = omp_get_wtime() - initialisation_end;
+    report.initialisation_seconds = initialisation_end - start;
+    report.timings                = grid.m_timings;
+    print_report(parameters, report);
+}
+
+/**
+ * Run the simulation on all the MPI processes and print its report from the process 0.
+ * @tparam Dimension dimension of the simulated space.
+ * @param parameters parameters of the simulation.
+ */
+template <std::size_t Dimension>
+void run_distributed_simulation(SimulationParameters const & parameters) {
+    SimulationReport report;
+    int process_ID;
+    MPI_Comm_size(MPI_COMM_WORLD, &report.processes);
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_ID);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double const start{MPI_Wtime()};
+    DistributedGrid<std::uniform_real_distribution<float>, Dimension> grid(parameters.number_of_boids,
+                                                                           parameters.neighbour_search,
+                                                                           parameters.force_kernel,
+                                                                           parameters.seed);
+    grid.m_imbalance_threshold = parameters.imbalance_threshold;
+    MPI_Barrier(MPI_COMM_WORLD);
+    double const initialisation_end{MPI_Wtime()};
+
+    for(std::size_t step{0}; step < parameters.number_of_steps; ++step) {
+        grid.update_all_boids();
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    report.simulation_seconds     = MPI_Wtime() - initialisation_end;
+    report.initialisation_seconds = initialisation_end - start;
+
+    // The slowest process gives the time of each phase.
+    double local_times[5]{grid.m_grid.m_timings.search_structure, grid.m_grid.m_timings.structure_of_arrays,
+                          grid.m_grid.m_timings.boid_update, grid.m_migration_time, grid.m_ghost_exchange_time};
+    double maximum_times[5];
+    MPI_Reduce(local_times, maximum_times, 5, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    report.timings.search_structure    = maximum_times[0];
+    report.timings.structure_of_arrays = maximum_times[1];
+    report.timings.boid_update         = maximum_times[2];
+    report.migration_seconds           = maximum_times[3];
+    report.ghost_exchange_seconds      = maximum_times[4];
+    report.timings.steps               = grid.m_grid.m_timings.steps;
+    report.rebalances                  = grid.m_rebalance_count;
+
+    if(process_ID == 0)
+        print_report(parameters, report);
+}
+
+int main(int argc, char ** argv) {
+    MPI_Init(&argc, &argv);
+    int process_ID, process_number;
+    MPI_Comm_size(MPI_COMM_WORLD, &process_number);
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_ID);
+
+    SimulationParameters parameters;
+    if(!parse_parameters(argc, argv, parameters)) {
+        if(process_ID == 0)
+            print_usage(argv[0]);
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
+
+    if(process_number > 1) {
+        if(parameters.dimension == 2)
+            run_distributed_simulation<2>(parameters);
+        else
+            run_distributed_simulation<3>(parameters);
+    }
+    else {
+        if(parameters.dimension == 2)
+            run_simulation<2>(parameters);
+        else
+            run_simulation<3>(parameters);
+    }
+    MPI_Finalize();
+    return EXIT_SUCCESS;
+}
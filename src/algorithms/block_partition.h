@@ -15,7 +15,7 @@
 #include "algorithms/complete_octree.h"
 #include "algorithms/sorted_range_count_distributed.h"
 #include "algorithms/partition.h"
-#include "algorithms/merge_sorted_arrays.h"
+#include "algorithms/exchange_and_merge.h"
 
 #if SWARMING_DO_ALL_CHECKS == 1
 #include <cassert>
@@ -66,46 +66,23 @@ std::vector< Octree<Dimension> > block_partition(std::vector< Octree<Dimension>
     // Here G is still sorted and covers the whole space
 
     // Redistribution of F: each processor will ask for the octants in F covered by the octants they have in G.
-    std::vector< std::vector< Octree<Dimension> > > received_sorted_data;
-    MPI_Request request;
+    // Gather the bounds of each processor.
+    std::array< Octree<Dimension>, 2> const bounds = {{G.front(), G.back().get_dld()}};
+    std::vector< Octree<Dimension> > all_bounds(2 * static_cast<std::size_t>(process_number));
+    MPI_Allgather(bounds.data(), 2, mpi_datatype< Octree<Dimension> >(),
+                  all_bounds.data(), 2, mpi_datatype< Octree<Dimension> >(), MPI_COMM_WORLD);
+
+    // Then compute the octants to send to each processor from the gathered bounds.
+    std::vector<std::size_t> displacements(process_number), counts(process_number);
     for(std::size_t p{0}; p < process_number; ++p) {
-
-        // Store the bounds of each processors.
-        std::array< Octree<Dimension>, 2> bounds = {G.front(), G.back().get_dld()};
-        // Broadcast the bounds from processor p.
-        MPI_Bcast(bounds.data(), 2 * sizeof(Octree<Dimension>), MPI_BYTE, p, MPI_COMM_WORLD);
-
-        // Then compute the octants to send to processor p from the broadcasted bounds.
-        auto const first_element = std::lower_bound(F.begin(), F.end(), bounds[0]);
-        auto const last_element  = std::upper_bound(F.begin(), F.end(), bounds[1]);
-        // We know that std::distance will output a positive integer because first_element is before last_element.
-        std::size_t const number_of_elements_to_send{ static_cast<std::size_t>(std::distance(first_element, last_element)) };
-
-        // Then send the size of the data
-        MPI_Isend(&number_of_elements_to_send, 1, MPI_UNSIGNED_LONG_LONG, p, /*tag*/ 0, MPI_COMM_WORLD, &request);
-        // And send the data if needed
-        if(number_of_elements_to_send > 0)
-            MPI_Isend(&(*first_element), number_of_elements_to_send * sizeof(Octree<Dimension>), MPI_BYTE,
-                      p, /*tag*/ 1, MPI_COMM_WORLD, &request);
-
-        // And receive if we are the processor p
-        if(process_ID == p) {
-            std::size_t number_of_elements_to_receive;
-            for(std::size_t proc{0}; proc < process_number; ++proc) {
-                MPI_Recv(&number_of_elements_to_receive, 1, MPI_UNSIGNED_LONG_LONG, proc, /*tag*/ 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                received_sorted_data.emplace_back(number_of_elements_to_receive);
-                if(number_of_elements_to_receive > 0)
-                    MPI_Recv(received_sorted_data.back().data(), number_of_elements_to_receive * sizeof(Octree<Dimension>),
-                             MPI_BYTE, proc, /*tag*/ 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            }
-        }
-        // Wait for the sending operations to finish because we don't want to exit the scope and destroy the memory
-        // locations that are sent.
-        MPI_Wait(&request, MPI_STATUS_IGNORE);
+        auto const first_element = std::lower_bound(F.begin(), F.end(), all_bounds[2 * p]);
+        auto const last_element  = std::upper_bound(first_element, F.end(), all_bounds[2 * p + 1]);
+        displacements[p] = static_cast<std::size_t>(std::distance(F.begin(), first_element));
+        counts[p]        = static_cast<std::size_t>(std::distance(first_element, last_element));
     }
 
-    // Now merge the received data
-    F = merge_sorted_arrays_sequential(received_sorted_data);
+    // Send the octants and merge the ones received while they arrive.
+    F = exchange_and_merge(std::move(F), displacements, counts, std::less< Octree<Dimension> >());
     return G;
 }
 
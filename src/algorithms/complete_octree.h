@@ -11,6 +11,7 @@
 #include "algorithms/linearise.h"
 #include "algorithms/partition.h"
 #include "definitions/constants.h"
+#include "definitions/mpi_types.h"
 #include "algorithms/is_sorted_distributed.h"
 
 #if SWARMING_DO_ALL_CHECKS == 1
@@ -46,10 +47,7 @@ std::vector<Octree<Dimension>> complete_octree(std::list<Octree<Dimension>> part
     std::function<unsigned long long(Octree<Dimension> const &)> weight = [](Octree<Dimension> const & octree){ return 1ULL; };
     partition(partial_list, weight);
 
-    Octree<Dimension> root;
-    for(std::size_t d{0}; d < Dimension; ++d)
-        root.m_anchor[d] = 0.0;
-    root.m_depth = 0;
+    Octree<Dimension> const root(Coordinate<Dimension>(0), 0);
 
     // TODO: Problem here!
     if (process_ID == 0) {
@@ -67,12 +65,12 @@ std::vector<Octree<Dimension>> complete_octree(std::list<Octree<Dimension>> part
 
     // Sending the first octree of the local list to the previous processor.
     if (process_ID > 0)
-        MPI_Isend(&partial_list.front(), sizeof(Octree<Dimension>), MPI_BYTE, process_ID-1, 0, MPI_COMM_WORLD, &request);
+        MPI_Isend(&partial_list.front(), 1, mpi_datatype< Octree<Dimension> >(), process_ID-1, 0, MPI_COMM_WORLD, &request);
 
     // Receiving the first octree of the next processor
     if (process_ID < process_number-1) {
         Octree<Dimension> recv;
-        MPI_Recv(&recv, sizeof(Octree<Dimension>), MPI_BYTE, process_ID+1, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        MPI_Recv(&recv, 1, mpi_datatype< Octree<Dimension> >(), process_ID+1, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
         partial_list.push_back(recv);
     }
 
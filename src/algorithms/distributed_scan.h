@@ -5,14 +5,94 @@
 #include <functional>
 #include <type_traits>
 #include <algorithm>
+#include <iterator>
 #include "mpi.h"
 #include "omp.h"
 
 #include "definitions/constants.h"
+#include "definitions/mpi_types.h"
+
+/**
+ * Number of elements under which the scans use a single thread: the threads would not have enough work.
+ */
+constexpr std::size_t PARALLEL_SCAN_MIN_SIZE{1 << 16};
+
+/**
+ * Compute the inclusive prefix sums of an array distributed over the processes, in place.
+ *
+ * The local array is cut in one block per thread. A first parallel pass sums each block; a single MPI_Exscan on the
+ * local total gives the sum of the arrays of the previous processes; a second parallel pass scans each block from
+ * the sum of the elements preceding it.
+ * @tparam T type of the values, with an MPI datatype (see mpi_datatype) and a sum (operator+=, see mpi_operation).
+ * @param values            the local values, replaced by the global inclusive prefix sums.
+ * @param size              the number of local values, possibly 0.
+ * @param number_of_threads the number of threads used, omp_get_max_threads() if 0.
+ */
+template <typename T>
+void distributed_scan_inplace(T * values, std::size_t size, int number_of_threads = 0) {
+    int process_ID;
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_ID);
+
+    if(number_of_threads <= 0)
+        number_of_threads = omp_get_max_threads();
+    if(size < PARALLEL_SCAN_MIN_SIZE)
+        number_of_threads = 1;
+    std::size_t const number_of_blocks{static_cast<std::size_t>(number_of_threads)};
+
+    // block_offsets[b] is the sum of the blocks before the block b, block_offsets[number_of_blocks] the local total.
+    std::vector<T> block_offsets(number_of_blocks + 1, T{});
+    #pragma omp parallel for num_threads(number_of_threads) schedule(static, 1)
+    for(std::size_t block = 0; block < number_of_blocks; ++block) {
+        T sum{};
+        for(std::size_t i{size * block / number_of_blocks}; i < size * (block + 1) / number_of_blocks; ++i)
+            sum += values[i];
+        block_offsets[block + 1] = sum;
+    }
+    for(std::size_t block{0}; block < number_of_blocks; ++block)
+        block_offsets[block + 1] += block_offsets[block];
 
-#if SWARMING_DO_ALL_CHECKS == 1
-#include <cassert>
-#endif
+    // The result of MPI_Exscan is undefined on the process 0.
+    T process_offset{};
+    MPI_Exscan(&block_offsets.back(), &process_offset, 1, mpi_datatype<T>(), mpi_operation<T>(), MPI_COMM_WORLD);
+    if(process_ID == 0)
+        process_offset = T{};
+
+    #pragma omp parallel for num_threads(number_of_threads) schedule(static, 1)
+    for(std::size_t block = 0; block < number_of_blocks; ++block) {
+        T sum{process_offset};
+        sum += block_offsets[block];
+        for(std::size_t i{size * block / number_of_blocks}; i < size * (block + 1) / number_of_blocks; ++i) {
+            sum += values[i];
+            values[i] = sum;
+        }
+    }
+}
+
+/**
+ * Compute the weights of the elements of a container, in parallel if the container has random-access iterators.
+ */
+template <typename Container, typename StoredDataType, typename IntTypeOut>
+static typename std::enable_if<std::is_base_of<std::random_access_iterator_tag,
+        typename std::iterator_traits<typename Container::const_iterator>::iterator_category>::value>::type
+compute_weights(Container const & container, std::function<IntTypeOut(StoredDataType const &)> const & weight,
+                std::vector<IntTypeOut> & weights, int number_of_threads) {
+    if(number_of_threads <= 0)
+        number_of_threads = omp_get_max_threads();
+    if(container.size() < PARALLEL_SCAN_MIN_SIZE)
+        number_of_threads = 1;
+    auto const first = container.begin();
+    #pragma omp parallel for num_threads(number_of_threads) schedule(static)
+    for(std::size_t i = 0; i < container.size(); ++i)
+        weights[i] = weight(first[i]);
+}
+
+template <typename Container, typename StoredDataType, typename IntTypeOut>
+static typename std::enable_if<!std::is_base_of<std::random_access_iterator_tag,
+        typename std::iterator_traits<typename Container::const_iterator>::iterator_category>::value>::type
+compute_weights(Container const & container, std::function<IntTypeOut(StoredDataType const &)> const & weight,
+                std::vector<IntTypeOut> & weights, int) {
+    std::transform(container.begin(), container.end(), weights.begin(), weight);
+}
 
 template <typename Container, typename StoredDataType = typename Container::value_type, typename IntTypeOut = unsigned long long>
 std::vector<IntTypeOut> local_scan(Container const & container,
@@ -30,52 +110,23 @@ std::vector<IntTypeOut> local_scan(Container const & container,
         result[i] = result[i-1] + weight(*container_it);
         ++container_it;
     }
-
     return result;
 };
 
+/**
+ * Compute the inclusive prefix sums of the weights of the elements of a container distributed over the processes.
+ * @param container         the local elements.
+ * @param weight            the weight of an element.
+ * @param number_of_threads the number of threads used, omp_get_max_threads() if 0.
+ * @return the sum of the weights of all the elements up to each local element, included.
+ */
 template <typename Container, typename StoredDataType = typename Container::value_type, typename IntTypeOut = unsigned long long>
 std::vector<IntTypeOut> distributed_scan(Container const & container,
-                                         std::function<IntTypeOut(StoredDataType const &)> weight) {
-
-    // Because of the difficulty to adapt the MPI_[type] at compile-time/runtime.
-    static_assert(std::is_same<IntTypeOut, unsigned long long>::value, "Template parameter IntTypeOut should be unsigned "
-            "long long. Other types are not currently implemented.");
-
-    int process_ID, process_number;
-    MPI_Comm_size(MPI_COMM_WORLD, &process_number);
-    MPI_Comm_rank(MPI_COMM_WORLD, &process_ID);
-
-    // First we perform a local scan on each processor.
-    std::vector<IntTypeOut> result = local_scan(container, weight);
-
-    // Then we do a distributed scan on the last local element of each processor.
-    IntTypeOut prefix;
-
-    MPI_Scan(&result.back(), &prefix, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
-
-    // And now each processor has the distributed scan result for its last element.
-    // It will send this result to the next processor, receive the result from the previous processor,
-    // and update its values according to the received result.
-    MPI_Request request;
-    if(process_ID < process_number-1)
-        MPI_Isend(&prefix, 1, MPI_UNSIGNED_LONG_LONG, process_ID+1, /*tag*/ 0, MPI_COMM_WORLD, &request);
-    if(process_ID > 0) {
-        IntTypeOut previous_prefix;
-        MPI_Recv(&previous_prefix, 1, MPI_UNSIGNED_LONG_LONG, process_ID - 1, /*tag*/ 0, MPI_COMM_WORLD,
-                 MPI_STATUS_IGNORE);
-        std::transform(result.begin(), result.end(), result.begin(),
-                       [previous_prefix](IntTypeOut integer) { return previous_prefix + integer; });
-    }
-
-    // We should wait for the first process to ensure it does not exit this scope before the sending operation is done.
-    if(process_ID == 0)
-        MPI_Wait(&request, MPI_STATUS_IGNORE);
-
-#if SWARMING_DO_ALL_CHECKS
-    assert(result.back() == prefix);
-#endif
-
+                                         std::function<IntTypeOut(StoredDataType const &)> weight,
+                                         int number_of_threads = 0) {
+    std::vector<IntTypeOut> result(container.size());
+    compute_weights(container, weight, result, number_of_threads);
+    distributed_scan_inplace(result.data(), result.size(), number_of_threads);
     return result;
 };
 
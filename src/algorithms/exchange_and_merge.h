@@ -0,0 +1,158 @@
+#ifndef SWARMING_PROJECT_EXCHANGE_AND_MERGE_H
+#define SWARMING_PROJECT_EXCHANGE_AND_MERGE_H
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+#include "mpi.h"
+
+#include "definitions/constants.h"
+#include "definitions/mpi_types.h"
+
+#if SWARMING_DO_ALL_CHECKS == 1
+#include <cassert>
+#endif
+
+/**
+ * Send a sorted run of elements to each process, and merge the sorted runs received from all the processes.
+ *
+ * The runs are received with non-blocking receives in a single buffer, at the offset of their sender, and merged
+ * as soon as they arrive: the runs are the leaves of a binary tree whose nodes are merged with std::inplace_merge
+ * when both children are complete, in the order the MPI_Waitany calls return them. The merges overlap the
+ * receptions of the slowest senders, and no array of arrays or second output buffer is allocated. The send buffer
+ * is freed as soon as all its runs are sent.
+ * @tparam T    type of the elements, sent with the datatype mpi_datatype<T>().
+ * @tparam Comp comparator used to sort the runs.
+ * @param send_buffer        the elements to send. Consumed by the function.
+ * @param send_displacements the run sent to the process p starts at send_buffer[send_displacements[p]].
+ * @param send_counts        the run sent to the process p has send_counts[p] elements, sorted with @a comp.
+ * @param comp               the comparator used to sort the runs.
+ * @return the merge of the runs received by this process.
+ */
+template <typename T, typename Comp = std::less<T>>
+static std::vector<T> exchange_and_merge(std::vector<T> && send_buffer,
+                                         std::vector<std::size_t> const & send_displacements,
+                                         std::vector<std::size_t> const & send_counts, Comp comp = Comp()) {
+    int process_ID, process_number;
+    MPI_Comm_size(MPI_COMM_WORLD, &process_number);
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_ID);
+    std::size_t const P{static_cast<std::size_t>(process_number)};
+    std::size_t const self{static_cast<std::size_t>(process_ID)};
+
+#if SWARMING_DO_ALL_CHECKS == 1
+    assert(send_displacements.size() == P && send_counts.size() == P);
+    for(std::size_t p{0}; p < P; ++p)
+        assert(std::is_sorted(send_buffer.begin() + send_displacements[p],
+                              send_buffer.begin() + send_displacements[p] + send_counts[p], comp));
+#endif
+
+    // The buffer is owned by the function, so it can be freed before the merge is finished.
+    std::vector<T> sent{std::move(send_buffer)};
+
+    std::vector<unsigned long long> counts(send_counts.begin(), send_counts.end()), receive_counts(P);
+    MPI_Alltoall(counts.data(), 1, MPI_UNSIGNED_LONG_LONG, receive_counts.data(), 1, MPI_UNSIGNED_LONG_LONG,
+                 MPI_COMM_WORLD);
+
+    // The run received from the process p is [receive_displacements[p], receive_displacements[p+1]).
+    std::vector<std::size_t> receive_displacements(P + 1, 0);
+    for(std::size_t p{0}; p < P; ++p)
+        receive_displacements[p + 1] = receive_displacements[p] + receive_counts[p];
+    std::vector<T> received(receive_displacements.back());
+
+    MPI_Datatype const element_type{mpi_datatype<T>()};
+
+    // requests[p] receives the run of the process p, requests[P + p] sends the run of the process p. The run of this
+    // process does not go through MPI.
+    std::vector<MPI_Request> requests(2 * P, MPI_REQUEST_NULL);
+    for(std::size_t p{0}; p < P; ++p) {
+        if(p != self && receive_counts[p] > 0)
+            MPI_Irecv(received.data() + receive_displacements[p], static_cast<int>(receive_counts[p]), element_type,
+                      static_cast<int>(p), /*tag*/ 1, MPI_COMM_WORLD, &requests[p]);
+    }
+    for(std::size_t p{0}; p < P; ++p) {
+        if(p != self && send_counts[p] > 0)
+            MPI_Isend(sent.data() + send_displacements[p], static_cast<int>(send_counts[p]), element_type,
+                      static_cast<int>(p), /*tag*/ 1, MPI_COMM_WORLD, &requests[P + p]);
+    }
+
+    // Binary tree over the runs: the leaf of the run p is the node number_of_leaves + p, the node n covers the runs
+    // [first_run[n], last_run[n]) and is complete when all its runs are received and merged.
+    std::size_t number_of_leaves{1};
+    while(number_of_leaves < P)
+        number_of_leaves *= 2;
+    std::vector<char> complete(2 * number_of_leaves, 0);
+    std::vector<std::size_t> first_run(2 * number_of_leaves), last_run(2 * number_of_leaves);
+    for(std::size_t leaf{0}; leaf < number_of_leaves; ++leaf) {
+        first_run[number_of_leaves + leaf] = std::min(leaf, P);
+        last_run[number_of_leaves + leaf]  = std::min(leaf + 1, P);
+    }
+    for(std::size_t node{number_of_leaves - 1}; node > 0; --node) {
+        first_run[node] = first_run[2 * node];
+        last_run[node]  = last_run[2 * node + 1];
+    }
+
+    // Mark the run p as received and merge the nodes completed by its reception.
+    auto const receive_run = [&](std::size_t p) {
+        std::size_t node{number_of_leaves + p};
+        complete[node] = 1;
+        while(node > 1 && complete[node ^ 1]) {
+            node /= 2;
+            std::inplace_merge(received.begin() + receive_displacements[first_run[node]],
+                               received.begin() + receive_displacements[first_run[2 * node + 1]],
+                               received.begin() + receive_displacements[last_run[node]], comp);
+            complete[node] = 1;
+        }
+    };
+
+    // The padding leaves and the runs that need no communication are complete from the start.
+    for(std::size_t leaf{P}; leaf < number_of_leaves; ++leaf)
+        receive_run(leaf);
+    std::copy(sent.begin() + send_displacements[self], sent.begin() + send_displacements[self] + send_counts[self],
+              received.begin() + receive_displacements[self]);
+    for(std::size_t p{0}; p < P; ++p) {
+        if(p == self || receive_counts[p] == 0)
+            receive_run(p);
+    }
+
+    std::size_t pending_sends{0};
+    for(std::size_t p{0}; p < P; ++p)
+        pending_sends += requests[P + p] != MPI_REQUEST_NULL;
+    if(pending_sends == 0)
+        std::vector<T>().swap(sent);
+
+    while(true) {
+        int index;
+        MPI_Waitany(static_cast<int>(requests.size()), requests.data(), &index, MPI_STATUS_IGNORE);
+        if(index == MPI_UNDEFINED)
+            break;
+        std::size_t const request{static_cast<std::size_t>(index)};
+        if(request < P)
+            receive_run(request);
+        else if(--pending_sends == 0)
+            std::vector<T>().swap(sent);
+    }
+
+#if SWARMING_DO_ALL_CHECKS == 1
+    assert(complete[1]);
+#endif
+    return received;
+}
+
+/**
+ * Send consecutive sorted runs of an array to the processes, and merge the sorted runs received.
+ * @param array  the array made of the runs to send, replaced by the merge of the runs received.
+ * @param limits the run sent to the process p is [limits[p], limits[p+1]).
+ * @param comp   the comparator used to sort the runs.
+ */
+template <typename T, typename Comp = std::less<T>>
+static void exchange_and_merge_inplace(std::vector<T> & array, std::vector<std::size_t> const & limits,
+                                       Comp comp = Comp()) {
+    std::vector<std::size_t> displacements(limits.begin(), limits.end() - 1), counts(limits.size() - 1);
+    for(std::size_t p{0}; p + 1 < limits.size(); ++p)
+        counts[p] = limits[p + 1] - limits[p];
+    array = exchange_and_merge(std::move(array), displacements, counts, comp);
+}
+
+#endif //SWARMING_PROJECT_EXCHANGE_AND_MERGE_H
@@ -0,0 +1,284 @@
+#ifndef SWARMING_PROJECT_FLOCKING_KERNELS_H
+#define SWARMING_PROJECT_FLOCKING_KERNELS_H
+
+#include <cstddef>
+#include <vector>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "definitions/types.h"
+#include "definitions/constants.h"
+#include "data_structures/BoidArrays.h"
+
+using types::Position;
+using types::Velocity;
+using types::Force;
+
+/**
+ * Vectorised implementations of the forces applied on a boid by its neighbours.
+ *
+ * The neighbours are given as a BoidArrays, i.e. packed contiguously coordinate by coordinate, so each instruction
+ * processes SimdFloat::WIDTH neighbours: 16 with AVX-512, 8 with AVX2 and 1 (scalar fallback) otherwise. The
+ * instruction set is chosen at compile-time from the flags given to the compiler (-mavx2, -mavx512f, -march=...).
+ *
+ * The force computed by neighbours_force_kernel is equal to the sum of the ones of Boid::cohesion_update,
+ * Boid::alignment_update and Boid::separation_update up to floating-point rounding, because the sums are not
+ * performed in the same order.
+ */
+
+#if defined(__AVX512F__)
+
+struct SimdFloat {
+    using Register = __m512;
+    static constexpr std::size_t WIDTH{16};
+
+    static Register zero()                              { return _mm512_setzero_ps(); }
+    static Register broadcast(float value)              { return _mm512_set1_ps(value); }
+    static Register load(float const * address)         { return _mm512_load_ps(address); }
+    static Register add(Register lhs, Register rhs)     { return _mm512_add_ps(lhs, rhs); }
+    static Register sub(Register lhs, Register rhs)     { return _mm512_sub_ps(lhs, rhs); }
+    static Register mul(Register lhs, Register rhs)     { return _mm512_mul_ps(lhs, rhs); }
+    /** @return value where lhs < rhs, 0 elsewhere. */
+    static Register select_less(Register lhs, Register rhs, Register value) {
+        return _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(lhs, rhs, _CMP_LT_OQ), value);
+    }
+    static float    sum(Register value)                 { return _mm512_reduce_add_ps(value); }
+
+    /** Bit i of a mask is set if the comparison is true for the lane i. */
+    using Mask = unsigned int;
+    static Mask less(Register lhs, Register rhs)        { return _mm512_cmp_ps_mask(lhs, rhs, _CMP_LT_OQ); }
+    static Mask less_equal(Register lhs, Register rhs)  { return _mm512_cmp_ps_mask(lhs, rhs, _CMP_LE_OQ); }
+};
+
+#elif defined(__AVX2__)
+
+struct SimdFloat {
+    using Register = __m256;
+    static constexpr std::size_t WIDTH{8};
+
+    static Register zero()                              { return _mm256_setzero_ps(); }
+    static Register broadcast(float value)              { return _mm256_set1_ps(value); }
+    static Register load(float const * address)         { return _mm256_load_ps(address); }
+    static Register add(Register lhs, Register rhs)     { return _mm256_add_ps(lhs, rhs); }
+    static Register sub(Register lhs, Register rhs)     { return _mm256_sub_ps(lhs, rhs); }
+    static Register mul(Register lhs, Register rhs)     { return _mm256_mul_ps(lhs, rhs); }
+    /** @return value where lhs < rhs, 0 elsewhere. */
+    static Register select_less(Register lhs, Register rhs, Register value) {
+        return _mm256_and_ps(_mm256_cmp_ps(lhs, rhs, _CMP_LT_OQ), value);
+    }
+    static float    sum(Register value) {
+        __m128 const halves_sum{_mm_add_ps(_mm256_castps256_ps128(value), _mm256_extractf128_ps(value, 1))};
+        __m128 const pairs_sum{_mm_add_ps(halves_sum, _mm_movehl_ps(halves_sum, halves_sum))};
+        return _mm_cvtss_f32(_mm_add_ss(pairs_sum, _mm_shuffle_ps(pairs_sum, pairs_sum, 1)));
+    }
+
+    /** Bit i of a mask is set if the comparison is true for the lane i. */
+    using Mask = unsigned int;
+    static Mask less(Register lhs, Register rhs) {
+        return static_cast<Mask>(_mm256_movemask_ps(_mm256_cmp_ps(lhs, rhs, _CMP_LT_OQ)));
+    }
+    static Mask less_equal(Register lhs, Register rhs) {
+        return static_cast<Mask>(_mm256_movemask_ps(_mm256_cmp_ps(lhs, rhs, _CMP_LE_OQ)));
+    }
+};
+
+#else
+
+struct SimdFloat {
+    using Register = float;
+    static constexpr std::size_t WIDTH{1};
+
+    static Register zero()                              { return 0.0f; }
+    static Register broadcast(float value)              { return value; }
+    static Register load(float const * address)         { return *address; }
+    static Register add(Register lhs, Register rhs)     { return lhs + rhs; }
+    static Register sub(Register lhs, Register rhs)     { return lhs - rhs; }
+    static Register mul(Register lhs, Register rhs)     { return lhs * rhs; }
+    /** @return value where lhs < rhs, 0 elsewhere. */
+    static Register select_less(Register lhs, Register rhs, Register value) { return (lhs < rhs) ? value : 0.0f; }
+    static float    sum(Register value)                 { return value; }
+
+    /** Bit i of a mask is set if the comparison is true for the lane i. */
+    using Mask = unsigned int;
+    static Mask less(Register lhs, Register rhs)        { return lhs <  rhs ? 1u : 0u; }
+    static Mask less_equal(Register lhs, Register rhs)  { return lhs <= rhs ? 1u : 0u; }
+};
+
+#endif
+
+/**
+ * Tell whether a direction is inside the vision cone of a boid, i.e. forms an angle smaller than VISION_ANGLE with
+ * the velocity of the boid.
+ *
+ * The angle is never computed: the cosine of the angle (dot_product / sqrt(squared_norms_product)) is compared to
+ * COS_VISION_ANGLE, and both sides are squared to avoid the square root. As in Boid::compute_angle, a null velocity
+ * or direction gives a cosine of 0, i.e. an angle of 90 degrees.
+ * @param dot_product           dot product between the velocity of the boid and the direction.
+ * @param squared_norms_product product of the squared norms of the velocity and of the direction.
+ * @return true if the direction is inside the vision cone, false otherwise.
+ */
+inline bool is_in_vision_cone(float dot_product, float squared_norms_product) {
+    float const squared_cos_times_norms{constants::COS_VISION_ANGLE * constants::COS_VISION_ANGLE * squared_norms_product};
+    if(constants::COS_VISION_ANGLE < 0)
+        return dot_product >= 0 || dot_product * dot_product < squared_cos_times_norms;
+    return dot_product > 0 && dot_product * dot_product > squared_cos_times_norms;
+}
+
+/**
+ * Compute the sum of the forces of cohesion, separation and alignment applied on a boid by its neighbours.
+ *
+ * The neighbours are loaded only once: the sums of their positions, of their velocities and of the directions to the
+ * close neighbours are accumulated in the same pass.
+ * @tparam Dimension dimension of the simulated space.
+ * @param position   position of the boid.
+ * @param neighbours positions and velocities of the boids visible by the boid.
+ * @return the sum of the three forces.
+ */
+template <std::size_t Dimension>
+Force<Dimension> neighbours_force_kernel(Position<Dimension> const & position,
+                                         BoidArrays<Dimension> const & neighbours) {
+    std::size_t const size{neighbours.size()};
+    std::size_t const vectorised_size{size - size % SimdFloat::WIDTH};
+    float const squared_repulsion_distance{constants::REPULSION_DISTANCE * constants::REPULSION_DISTANCE};
+
+    typename SimdFloat::Register positions[Dimension];
+    typename SimdFloat::Register position_sums[Dimension], velocity_sums[Dimension], close_sums[Dimension];
+    for(std::size_t d{0}; d < Dimension; ++d) {
+        positions[d]     = SimdFloat::broadcast(position[d]);
+        position_sums[d] = SimdFloat::zero();
+        velocity_sums[d] = SimdFloat::zero();
+        close_sums[d]    = SimdFloat::zero();
+    }
+    typename SimdFloat::Register const threshold{SimdFloat::broadcast(squared_repulsion_distance)};
+
+    for(std::size_t k{0}; k < vectorised_size; k += SimdFloat::WIDTH) {
+        typename SimdFloat::Register neighbour_positions[Dimension], to_neighbour[Dimension];
+        typename SimdFloat::Register squared_distance{SimdFloat::zero()};
+        for(std::size_t d{0}; d < Dimension; ++d) {
+            neighbour_positions[d] = SimdFloat::load(neighbours.m_positions[d].data() + k);
+            to_neighbour[d]        = SimdFloat::sub(neighbour_positions[d], positions[d]);
+            squared_distance       = SimdFloat::add(squared_distance, SimdFloat::mul(to_neighbour[d], to_neighbour[d]));
+            position_sums[d]       = SimdFloat::add(position_sums[d], neighbour_positions[d]);
+            velocity_sums[d]       = SimdFloat::add(velocity_sums[d],
+                                                    SimdFloat::load(neighbours.m_velocities[d].data() + k));
+        }
+        for(std::size_t d{0}; d < Dimension; ++d)
+            close_sums[d] = SimdFloat::add(close_sums[d],
+                                           SimdFloat::select_less(squared_distance, threshold, to_neighbour[d]));
+    }
+
+    float position_sum[Dimension], velocity_sum[Dimension], close_sum[Dimension];
+    for(std::size_t d{0}; d < Dimension; ++d) {
+        position_sum[d] = SimdFloat::sum(position_sums[d]);
+        velocity_sum[d] = SimdFloat::sum(velocity_sums[d]);
+        close_sum[d]    = SimdFloat::sum(close_sums[d]);
+    }
+    for(std::size_t k{vectorised_size}; k < size; ++k) {
+        float to_neighbour[Dimension];
+        float squared_distance{0.0f};
+        for(std::size_t d{0}; d < Dimension; ++d) {
+            to_neighbour[d]   = neighbours.m_positions[d][k] - position[d];
+            squared_distance += to_neighbour[d] * to_neighbour[d];
+            position_sum[d]  += neighbours.m_positions[d][k];
+            velocity_sum[d]  += neighbours.m_velocities[d][k];
+        }
+        if(squared_distance < squared_repulsion_distance) {
+            for(std::size_t d{0}; d < Dimension; ++d)
+                close_sum[d] += to_neighbour[d];
+        }
+    }
+
+    Force<Dimension> force;
+    for(std::size_t d{0}; d < Dimension; ++d) {
+        force[d] = -constants::SEPARATION_NORMALISER * close_sum[d];
+        if(size > 0) {
+            force[d] += constants::COHESION_NORMALISER * (position_sum[d] / size - position[d]);
+            force[d] += constants::ALIGNMENT_NORMALISER / size * velocity_sum[d];
+        }
+    }
+    return force;
+}
+
+/**
+ * Find the boids visible by a given boid among a contiguous block of candidates.
+ *
+ * This is the batched version of Boid::is_visible: SimdFloat::WIDTH candidates are tested per instruction.
+ * The boid itself is not excluded, the caller should skip its index if it is part of the block.
+ * @tparam Dimension dimension of the simulated space.
+ * @param position   position of the boid.
+ * @param velocity   velocity of the boid.
+ * @param candidates positions and velocities of the candidate boids.
+ * @param first      index of the first candidate to test in @a candidates.
+ * @param last       index following the last candidate to test in @a candidates.
+ * @param visible    the indices (in @a candidates) of the visible candidates are appended to this vector.
+ */
+template <std::size_t Dimension>
+void select_visible(Position<Dimension> const & position, Velocity<Dimension> const & velocity,
+                    BoidArrays<Dimension> const & candidates, std::size_t first, std::size_t last,
+                    std::vector<std::size_t> & visible) {
+    float const squared_vision_distance{constants::VISION_DISTANCE * constants::VISION_DISTANCE};
+    float squared_speed{0.0f};
+    for(std::size_t d{0}; d < Dimension; ++d)
+        squared_speed += velocity[d] * velocity[d];
+
+    auto const test_scalar = [&](std::size_t k) {
+        float squared_distance{0.0f}, dot_product{0.0f};
+        for(std::size_t d{0}; d < Dimension; ++d) {
+            float const to_candidate{candidates.m_positions[d][k] - position[d]};
+            squared_distance += to_candidate * to_candidate;
+            dot_product      += velocity[d] * to_candidate;
+        }
+        if(squared_distance <= squared_vision_distance &&
+           is_in_vision_cone(dot_product, squared_speed * squared_distance))
+            visible.push_back(k);
+    };
+
+    // Scalar tests until the candidates are aligned for the vectorised loads.
+    std::size_t k{first};
+    for(; k < last && k % SimdFloat::WIDTH != 0; ++k)
+        test_scalar(k);
+
+    typename SimdFloat::Register positions[Dimension], velocities[Dimension];
+    for(std::size_t d{0}; d < Dimension; ++d) {
+        positions[d]  = SimdFloat::broadcast(position[d]);
+        velocities[d] = SimdFloat::broadcast(velocity[d]);
+    }
+    typename SimdFloat::Register const vision_threshold{SimdFloat::broadcast(squared_vision_distance)};
+    typename SimdFloat::Register const cone_factor{SimdFloat::broadcast(
+            constants::COS_VISION_ANGLE * constants::COS_VISION_ANGLE * squared_speed)};
+    typename SimdFloat::Register const zero{SimdFloat::zero()};
+
+    for(; k + SimdFloat::WIDTH <= last; k += SimdFloat::WIDTH) {
+        typename SimdFloat::Register squared_distance{SimdFloat::zero()}, dot_product{SimdFloat::zero()};
+        for(std::size_t d{0}; d < Dimension; ++d) {
+            typename SimdFloat::Register const to_candidate{
+                    SimdFloat::sub(SimdFloat::load(candidates.m_positions[d].data() + k), positions[d])};
+            squared_distance = SimdFloat::add(squared_distance, SimdFloat::mul(to_candidate, to_candidate));
+            dot_product      = SimdFloat::add(dot_product, SimdFloat::mul(velocities[d], to_candidate));
+        }
+        typename SimdFloat::Register const squared_dot_product{SimdFloat::mul(dot_product, dot_product)};
+        typename SimdFloat::Register const squared_cos_times_norms{SimdFloat::mul(cone_factor, squared_distance)};
+
+        // Same tests as in is_in_vision_cone, lane by lane.
+        typename SimdFloat::Mask in_cone;
+        if(constants::COS_VISION_ANGLE < 0)
+            in_cone = SimdFloat::less_equal(zero, dot_product) |
+                      SimdFloat::less(squared_dot_product, squared_cos_times_norms);
+        else
+            in_cone = SimdFloat::less(zero, dot_product) &
+                      SimdFloat::less(squared_cos_times_norms, squared_dot_product);
+
+        typename SimdFloat::Mask mask{SimdFloat::less_equal(squared_distance, vision_threshold) & in_cone};
+        while(mask != 0) {
+            visible.push_back(k + static_cast<std::size_t>(__builtin_ctz(mask)));
+            mask &= mask - 1;
+        }
+    }
+
+    for(; k < last; ++k)
+        test_scalar(k);
+}
+
+#endif //SWARMING_PROJECT_FLOCKING_KERNELS_H
@@ -5,6 +5,7 @@
 #include <functional>
 
 #include "mpi.h"
+#include "definitions/mpi_types.h"
 
 template <typename Container, typename StoredDataType = typename Container::value_type, typename Comp = std::less<StoredDataType>>
 bool is_sorted_distributed(Container const & container, Comp comp = Comp()) {
@@ -25,12 +26,12 @@ bool is_sorted_distributed(Container const & container, Comp comp = Comp()) {
 
     MPI_Request request;
     if (process_ID != process_number - 1)
-        MPI_Isend(&container.back(), sizeof(StoredDataType), MPI_BYTE, process_ID + 1, /*tag*/ 0,
+        MPI_Isend(&container.back(), 1, mpi_datatype<StoredDataType>(), process_ID + 1, /*tag*/ 0,
                   MPI_COMM_WORLD, &request);
 
     if (process_ID != 0) {
         StoredDataType tmp;
-        MPI_Recv(&tmp, sizeof(StoredDataType), MPI_BYTE, process_ID - 1, /*tag*/ 0, MPI_COMM_WORLD,
+        MPI_Recv(&tmp, 1, mpi_datatype<StoredDataType>(), process_ID - 1, /*tag*/ 0, MPI_COMM_WORLD,
                  MPI_STATUS_IGNORE);
         if (comp(container.front(), tmp))
             local_result = false;
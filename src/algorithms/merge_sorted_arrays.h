@@ -3,78 +3,271 @@
 
 #include <vector>
 #include <algorithm>
-#include <list>
-#include <numeric>
+#include <type_traits>
+#include <utility>
+#include <iterator>
+#include <functional>
+#include <omp.h>
 
 #include "definitions/constants.h"
 
-#if SWARMING_DO_ALL_CHECKS == 1
-#include <iostream>
-#endif
+/**
+ * Find the positions splitting sorted runs at a given rank of their merge (exact k-way co-ranking).
+ *
+ * A pivot is taken in the middle of the largest remaining window of a run, and its rank in the merge is computed
+ * with a binary search in the window of each run. The windows shrink until the rank falls among the elements equal
+ * to the pivot, which are then taken in the order of the runs: O(k log(n)) iterations of O(k log(n)).
+ * @param runs the sorted runs, as [first, last) pairs of random-access iterators.
+ * @param rank the rank of the split in the merge of the runs, at most the total number of elements.
+ * @param comp the comparator used to sort the runs.
+ * @return positions such that the sum of the positions is @a rank and no element of runs[r] before positions[r] is
+ *         greater than an element of another run after its position.
+ */
+template <typename Iterator, typename Comp>
+static std::vector<std::size_t> multiway_split(std::vector< std::pair<Iterator, Iterator> > const & runs,
+                                               std::size_t rank, Comp comp) {
+    std::size_t const number_of_runs{runs.size()};
+    // The split of the run r is in [lower[r], upper[r]].
+    std::vector<std::size_t> lower(number_of_runs, 0), upper(number_of_runs);
+    for(std::size_t r{0}; r < number_of_runs; ++r)
+        upper[r] = static_cast<std::size_t>(runs[r].second - runs[r].first);
+    std::vector<std::size_t> less(number_of_runs), less_or_equal(number_of_runs);
 
-template <typename T, typename Comp = std::less<T>, typename ContainerOut = std::vector<T>>
-static ContainerOut merge_sorted_arrays_sequential(std::vector< std::vector<T> > & arrays, Comp comp = Comp()) {
+    while(true) {
+        // Pivot: the middle of the largest window.
+        std::size_t pivot_run{0};
+        for(std::size_t r{1}; r < number_of_runs; ++r) {
+            if(upper[r] - lower[r] > upper[pivot_run] - lower[pivot_run])
+                pivot_run = r;
+        }
+        if(number_of_runs == 0 || upper[pivot_run] == lower[pivot_run])
+            return lower;
+        auto const & pivot = *(runs[pivot_run].first + (lower[pivot_run] + upper[pivot_run]) / 2);
 
-    // We compute the result in a std::vector because the std::merge_inplace and std::merge will benefit from the
-    // data locality.
-    std::vector<T> result;
+        // Rank of the elements less than the pivot and not greater than the pivot.
+        std::size_t total_less{0}, total_less_or_equal{0};
+        for(std::size_t r{0}; r < number_of_runs; ++r) {
+            Iterator const first{runs[r].first + lower[r]}, last{runs[r].first + upper[r]};
+            Iterator const first_equal{std::lower_bound(first, last, pivot, comp)};
+            less[r]          = static_cast<std::size_t>(first_equal - runs[r].first);
+            less_or_equal[r] = static_cast<std::size_t>(std::upper_bound(first_equal, last, pivot, comp)
+                                                        - runs[r].first);
+            total_less          += less[r];
+            total_less_or_equal += less_or_equal[r];
+        }
 
-#if SWARMING_DO_ALL_CHECKS == 1
-    if(arrays.size() < 2) {
-        std::cerr << "merge_sorted_arrays_sequential should be called with 2 or more arrays to merge." << std::endl;
-        return ContainerOut(result.begin(), result.end());
+        if(rank < total_less)
+            upper.swap(less);
+        else if(rank > total_less_or_equal)
+            lower.swap(less_or_equal);
+        else {
+            // The elements equal to the pivot are split in the order of the runs.
+            std::size_t remaining{rank - total_less};
+            for(std::size_t r{0}; r < number_of_runs; ++r) {
+                std::size_t const taken{std::min(remaining, less_or_equal[r] - less[r])};
+                less[r]   += taken;
+                remaining -= taken;
+            }
+            return less;
+        }
     }
-#endif
-
-    // Sort the vector of values by increasing lengths for a better efficiency.
-    // We can try to remove the 2 following lines after and analyse the performance.
-    auto comparator = [] (std::vector<T> const & lhs, std::vector<T> const & rhs) { return lhs.size() < rhs.size(); };
-    std::sort(arrays.begin(), arrays.end(), comparator);
-
-    // Computing the total number of elements in order to save some re-allocations
-    auto add_size = [] (std::size_t const & previous_size, std::vector<T> const & elem) { return previous_size + elem.size(); };
-
-    std::size_t const number_of_elements{ std::accumulate(arrays.begin(), arrays.end(), static_cast<std::size_t>(0), add_size) };
-
-    // Resize the resulting vector to be sure that all the values can fit in it.
-    result.resize(number_of_elements);
-
-    // First step, use the std::merge to combine the merge and the copy of the data.
-    // We also keep track of the iterator that separate 2 non-sorted lists in separators.
-    // separators stores iterators pointing to the beginning of a non-sorted sequence.
-    std::list< typename std::vector<T>::iterator > separators{result.begin()};
-    std::size_t next_free_position{0};
-    for(std::size_t i{0}; i < arrays.size()/2; ++i) {
-        separators.emplace_back( std::merge(arrays[2*i].begin()  , arrays[2*i].end(),   /*input  1*/
-                                            arrays[2*i+1].begin(), arrays[2*i+1].end(), /*input  2*/
-                                            result.begin() + next_free_position,        /*output 1*/
-                                            comp) );
-        next_free_position += arrays[2*i].size() + arrays[2*i+1].size();
+}
+
+/**
+ * Merge sorted runs sequentially, in a single pass, with a tree of losers.
+ *
+ * Each internal node of the tree stores the run that lost the comparison of the heads at that node, and the root
+ * the overall winner: after an element is output, only the path from the leaf of its run to the root is replayed,
+ * i.e. log2(number of runs) comparisons per element. Equal elements are output in the order of the runs.
+ * @param runs   the sorted runs, as [first, last) pairs of iterators. Wrap the iterators in std::move_iterator to
+ *               move the elements instead of copying them.
+ * @param output the beginning of the output range, with room for all the elements of the runs.
+ * @param comp   the comparator used to sort the runs.
+ * @return the end of the output range.
+ */
+template <typename Iterator, typename OutputIterator, typename Comp>
+static OutputIterator multiway_merge(std::vector< std::pair<Iterator, Iterator> > const & runs, OutputIterator output,
+                                     Comp comp) {
+    // Heads and ends of the non-empty runs, in the order of the runs. The tree is rebuilt each time a run is
+    // exhausted, so the matches compare the heads without checking if the runs are empty.
+    std::vector<Iterator> heads, ends;
+    for(auto const & run : runs) {
+        if(run.first != run.second) {
+            heads.push_back(run.first);
+            ends.push_back(run.second);
+        }
     }
 
-    if(arrays.size()%2)
-        separators.emplace_back( std::copy(arrays.back().begin(), arrays.back().end(), separators.back()) );
-
-    // Now result contain all the values, we just need to merge all the lists not merged in the previous step.
-    // In the separators list, we also have the begin() and end() iterators, that is why our stop condition is
-    // that the separators list should contain only 2 elements: the begin() and the end()
-    while(separators.size() != 2) {
-        // We will iterate over each separators, and each time merge two blocks
-        // by merging first the smallest blocks.
-        auto left_iterator   = separators.begin();
-        auto middle_iterator = std::next(left_iterator);
-        while(*middle_iterator != result.end() && separators.size() != 2) {
-            auto right_iterator = std::next(middle_iterator);
-            std::inplace_merge(*left_iterator, *middle_iterator, *right_iterator, comp);
-            separators.erase(middle_iterator);
-            left_iterator   = right_iterator;
-            middle_iterator = std::next(right_iterator);
+    // losers[0] is the winner, losers[node] the loser of the match at node; the leaf of the run r is the node
+    // number_of_leaves + r. The additional leaves, up to a power of 2, always lose.
+    std::vector<std::size_t> losers, winners;
+    while(!heads.empty()) {
+        std::size_t const number_of_runs{heads.size()};
+        std::size_t number_of_leaves{1};
+        while(number_of_leaves < number_of_runs)
+            number_of_leaves *= 2;
+
+        // True if the head of the run lhs is output before the head of the run rhs.
+        auto const wins = [&heads, &comp, number_of_runs](std::size_t lhs, std::size_t rhs) {
+            if(rhs >= number_of_runs)
+                return true;
+            if(lhs >= number_of_runs)
+                return false;
+            if(comp(*heads[lhs], *heads[rhs]))
+                return true;
+            return !comp(*heads[rhs], *heads[lhs]) && lhs < rhs;
+        };
+
+        losers.assign(number_of_leaves, 0);
+        winners.assign(2 * number_of_leaves, 0);
+        for(std::size_t r{0}; r < number_of_leaves; ++r)
+            winners[number_of_leaves + r] = r;
+        for(std::size_t node{number_of_leaves - 1}; node > 0; --node) {
+            std::size_t const lhs{winners[2 * node]}, rhs{winners[2 * node + 1]};
+            bool const lhs_wins{wins(lhs, rhs)};
+            winners[node] = lhs_wins ? lhs : rhs;
+            losers[node]  = lhs_wins ? rhs : lhs;
+        }
+
+        std::size_t winner{winners[1]};
+        while(true) {
+            *output = *heads[winner];
+            ++output;
+            if(++heads[winner] == ends[winner])
+                break;
+            for(std::size_t node{(number_of_leaves + winner) / 2}; node > 0; node /= 2) {
+                std::size_t const loser{losers[node]};
+                bool const loser_wins{wins(loser, winner)};
+                losers[node] = loser_wins ? winner : loser;
+                winner       = loser_wins ? loser  : winner;
+            }
         }
+        heads.erase(heads.begin() + static_cast<std::ptrdiff_t>(winner));
+        ends.erase(ends.begin() + static_cast<std::ptrdiff_t>(winner));
+    }
+    return output;
+}
+
+/**
+ * Merge sorted runs with several OpenMP threads.
+ *
+ * The output is cut in number_of_threads slices of equal size, and the part of each run going to each slice is
+ * found with multiway_split, so each thread merges its slice independently.
+ * @param runs              the sorted runs, as [first, last) pairs of random-access iterators, possibly wrapped in
+ *                          std::move_iterator.
+ * @param output            the beginning of the output range, a random-access iterator with room for all the elements
+ *                          of the runs. Should not overlap the runs.
+ * @param comp              the comparator used to sort the runs.
+ * @param number_of_threads the number of threads used, omp_get_max_threads() if 0.
+ */
+template <typename Iterator, typename OutputIterator, typename Comp>
+static void multiway_merge_parallel(std::vector< std::pair<Iterator, Iterator> > const & runs, OutputIterator output,
+                                    Comp comp, int number_of_threads = 0) {
+    if(number_of_threads <= 0)
+        number_of_threads = omp_get_max_threads();
+    std::size_t total_size{0};
+    for(auto const & run : runs)
+        total_size += static_cast<std::size_t>(run.second - run.first);
+
+    std::size_t const number_of_slices{static_cast<std::size_t>(number_of_threads)};
+    if(number_of_slices == 1) {
+        multiway_merge(runs, output, comp);
+        return;
     }
 
-    // Return the result
-    return ContainerOut(result.begin(), result.end());
+    // All the splits are found before merging: with std::move_iterator, the merge moves from the elements read by
+    // the co-ranking of the other slices.
+    std::vector< std::vector<std::size_t> > positions(number_of_slices + 1);
+    #pragma omp parallel for num_threads(number_of_threads) schedule(static, 1)
+    for(std::size_t slice = 0; slice <= number_of_slices; ++slice)
+        positions[slice] = multiway_split(runs, total_size * slice / number_of_slices, comp);
+
+    #pragma omp parallel for num_threads(number_of_threads) schedule(static, 1)
+    for(std::size_t slice = 0; slice < number_of_slices; ++slice) {
+        std::vector< std::pair<Iterator, Iterator> > slice_runs;
+        slice_runs.reserve(runs.size());
+        for(std::size_t r{0}; r < runs.size(); ++r)
+            slice_runs.emplace_back(runs[r].first + positions[slice][r], runs[r].first + positions[slice + 1][r]);
+        multiway_merge(slice_runs, output + total_size * slice / number_of_slices, comp);
+    }
+}
+
+/**
+ * Merge sorted arrays with several OpenMP threads.
+ * @param arrays            the sorted arrays.
+ * @param comp              the comparator used to sort the arrays.
+ * @param number_of_threads the number of threads used, omp_get_max_threads() if 0.
+ * @return the merge of the arrays.
+ */
+template <typename T, typename Comp = std::less<T>>
+static std::vector<T> merge_sorted_arrays_parallel(std::vector< std::vector<T> > const & arrays, Comp comp = Comp(),
+                                                   int number_of_threads = 0) {
+    std::vector< std::pair<typename std::vector<T>::const_iterator, typename std::vector<T>::const_iterator> > runs;
+    std::size_t total_size{0};
+    for(auto const & array : arrays) {
+        runs.emplace_back(array.begin(), array.end());
+        total_size += array.size();
+    }
+    std::vector<T> result(total_size);
+    multiway_merge_parallel(runs, result.begin(), comp, number_of_threads);
+    return result;
+}
+
+/**
+ * Merge sorted arrays with several OpenMP threads, moving the elements out of the arrays instead of copying them.
+ * @param arrays            the sorted arrays. Their elements are moved from.
+ * @param comp              the comparator used to sort the arrays.
+ * @param number_of_threads the number of threads used, omp_get_max_threads() if 0.
+ * @return the merge of the arrays.
+ */
+template <typename T, typename Comp = std::less<T>>
+static std::vector<T> merge_sorted_arrays_parallel(std::vector< std::vector<T> > && arrays, Comp comp = Comp(),
+                                                   int number_of_threads = 0) {
+    using MoveIterator = std::move_iterator<typename std::vector<T>::iterator>;
+    std::vector< std::pair<MoveIterator, MoveIterator> > runs;
+    std::size_t total_size{0};
+    for(auto & array : arrays) {
+        runs.emplace_back(MoveIterator(array.begin()), MoveIterator(array.end()));
+        total_size += array.size();
+    }
+    std::vector<T> result(total_size);
+    multiway_merge_parallel(runs, result.begin(), comp, number_of_threads);
+    return result;
 }
 
+/**
+ * Convert the merged values to the container type requested by merge_sorted_arrays_sequential.
+ */
+template <typename ContainerOut, typename T>
+static typename std::enable_if<std::is_same<ContainerOut, std::vector<T>>::value, ContainerOut>::type
+to_merged_container(std::vector<T> && values) {
+    return std::move(values);
+}
+
+template <typename ContainerOut, typename T>
+static typename std::enable_if<!std::is_same<ContainerOut, std::vector<T>>::value, ContainerOut>::type
+to_merged_container(std::vector<T> && values) {
+    return ContainerOut(std::make_move_iterator(values.begin()), std::make_move_iterator(values.end()));
+}
+
+/**
+ * Merge sorted arrays sequentially, in a single pass over the elements (see multiway_merge).
+ * @param arrays the sorted arrays. Their elements are moved from.
+ * @param comp   the comparator used to sort the arrays.
+ * @return the merge of the arrays.
+ */
+template <typename T, typename Comp = std::less<T>, typename ContainerOut = std::vector<T>>
+static ContainerOut merge_sorted_arrays_sequential(std::vector< std::vector<T> > & arrays, Comp comp = Comp()) {
+    using MoveIterator = std::move_iterator<typename std::vector<T>::iterator>;
+    std::vector< std::pair<MoveIterator, MoveIterator> > runs;
+    std::size_t total_size{0};
+    for(auto & array : arrays) {
+        runs.emplace_back(MoveIterator(array.begin()), MoveIterator(array.end()));
+        total_size += array.size();
+    }
+    std::vector<T> result(total_size);
+    multiway_merge(runs, result.begin(), comp);
+    return to_merged_container<ContainerOut>(std::move(result));
+}
 
 #endif //SWARMING_PROJECT_MERGE_SORTED_ARRAYS_H
@@ -5,10 +5,157 @@
 #include <array>
 #include "definitions/constants.h"
 
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
 #if SWARMING_DO_ALL_CHECKS == 1
 #include <cassert>
 #endif
 
+/**
+ * Interleave and de-interleave the bits of the D coordinates of an anchor: bit j of the coordinate d is stored at bit
+ * j * D + d of the code. Only the constants::Dmax lowest bits of each coordinate are kept.
+ *
+ * The generic version moves the bits one by one. The specialisations for D = 2 and D = 3 use the PDEP / PEXT
+ * instructions when the compiler targets BMI2 (-mbmi2, -march=...), and the "magic bits" shifts and masks otherwise.
+ * @tparam D dimension of the anchor.
+ */
+template <std::size_t D>
+struct MortonCodec {
+    static unsigned long long encode(std::array<unsigned long long, D> const & anchor) {
+        unsigned long long code{0};
+        unsigned int bit_position{0};
+        for (unsigned int dimension_bit_position{0}; dimension_bit_position < constants::Dmax; ++dimension_bit_position){
+            for (std::size_t dimension{0}; dimension < D; ++dimension){
+                code |= ((anchor[dimension] >> dimension_bit_position) & 1ULL) << bit_position;
+                ++bit_position;
+            }
+        }
+        return code;
+    }
+
+    static std::array<unsigned long long, D> decode(unsigned long long code) {
+        std::array<unsigned long long, D> anchor;
+        anchor.fill(0);
+        unsigned int bit_position{0};
+        for (unsigned int dimension_bit_position{0}; dimension_bit_position < constants::Dmax; ++dimension_bit_position){
+            for (std::size_t dimension{0}; dimension < D; ++dimension){
+                anchor[dimension] |= ((code >> bit_position) & 1ULL) << dimension_bit_position;
+                ++bit_position;
+            }
+        }
+        return anchor;
+    }
+};
+
+namespace morton_details {
+    // Bits of the code holding the first coordinate, for Dmax levels.
+    constexpr unsigned long long MASK_2D{0x5555555555555555ULL & ((1ULL << (2 * constants::Dmax)) - 1)};
+    constexpr unsigned long long MASK_3D{0x9249249249249249ULL & ((1ULL << (3 * constants::Dmax)) - 1)};
+    constexpr unsigned long long COORDINATE_MASK{(1ULL << constants::Dmax) - 1};
+
+    static_assert(constants::Dmax <= 21, "The Morton codes of D = 3 anchors must fit in 64 bits.");
+
+#if !defined(__BMI2__)
+    /**
+     * Insert a zero bit between each of the 32 lowest bits of x.
+     */
+    inline unsigned long long spread_by_1(unsigned long long x) {
+        x &= 0x00000000FFFFFFFFULL;
+        x = (x | (x << 16)) & 0x0000FFFF0000FFFFULL;
+        x = (x | (x <<  8)) & 0x00FF00FF00FF00FFULL;
+        x = (x | (x <<  4)) & 0x0F0F0F0F0F0F0F0FULL;
+        x = (x | (x <<  2)) & 0x3333333333333333ULL;
+        x = (x | (x <<  1)) & 0x5555555555555555ULL;
+        return x;
+    }
+
+    /**
+     * Inverse of spread_by_1: gather the even bits of x.
+     */
+    inline unsigned long long compact_by_1(unsigned long long x) {
+        x &= 0x5555555555555555ULL;
+        x = (x | (x >>  1)) & 0x3333333333333333ULL;
+        x = (x | (x >>  2)) & 0x0F0F0F0F0F0F0F0FULL;
+        x = (x | (x >>  4)) & 0x00FF00FF00FF00FFULL;
+        x = (x | (x >>  8)) & 0x0000FFFF0000FFFFULL;
+        x = (x | (x >> 16)) & 0x00000000FFFFFFFFULL;
+        return x;
+    }
+
+    /**
+     * Insert two zero bits between each of the 21 lowest bits of x.
+     */
+    inline unsigned long long spread_by_2(unsigned long long x) {
+        x &= 0x00000000001FFFFFULL;
+        x = (x | (x << 32)) & 0x001F00000000FFFFULL;
+        x = (x | (x << 16)) & 0x001F0000FF0000FFULL;
+        x = (x | (x <<  8)) & 0x100F00F00F00F00FULL;
+        x = (x | (x <<  4)) & 0x10C30C30C30C30C3ULL;
+        x = (x | (x <<  2)) & 0x1249249249249249ULL;
+        return x;
+    }
+
+    /**
+     * Inverse of spread_by_2: gather one bit out of three of x.
+     */
+    inline unsigned long long compact_by_2(unsigned long long x) {
+        x &= 0x1249249249249249ULL;
+        x = (x | (x >>  2)) & 0x10C30C30C30C30C3ULL;
+        x = (x | (x >>  4)) & 0x100F00F00F00F00FULL;
+        x = (x | (x >>  8)) & 0x001F0000FF0000FFULL;
+        x = (x | (x >> 16)) & 0x001F00000000FFFFULL;
+        x = (x | (x >> 32)) & 0x00000000001FFFFFULL;
+        return x;
+    }
+#endif
+}
+
+template <>
+struct MortonCodec<2> {
+    static unsigned long long encode(std::array<unsigned long long, 2> const & anchor) {
+        using namespace morton_details;
+#if defined(__BMI2__)
+        return _pdep_u64(anchor[0], MASK_2D) | _pdep_u64(anchor[1], MASK_2D << 1);
+#else
+        return spread_by_1(anchor[0] & COORDINATE_MASK) | (spread_by_1(anchor[1] & COORDINATE_MASK) << 1);
+#endif
+    }
+
+    static std::array<unsigned long long, 2> decode(unsigned long long code) {
+        using namespace morton_details;
+#if defined(__BMI2__)
+        return {{_pext_u64(code, MASK_2D), _pext_u64(code, MASK_2D << 1)}};
+#else
+        return {{compact_by_1(code & MASK_2D), compact_by_1((code >> 1) & MASK_2D)}};
+#endif
+    }
+};
+
+template <>
+struct MortonCodec<3> {
+    static unsigned long long encode(std::array<unsigned long long, 3> const & anchor) {
+        using namespace morton_details;
+#if defined(__BMI2__)
+        return _pdep_u64(anchor[0], MASK_3D) | _pdep_u64(anchor[1], MASK_3D << 1) | _pdep_u64(anchor[2], MASK_3D << 2);
+#else
+        return spread_by_2(anchor[0] & COORDINATE_MASK) | (spread_by_2(anchor[1] & COORDINATE_MASK) << 1)
+             | (spread_by_2(anchor[2] & COORDINATE_MASK) << 2);
+#endif
+    }
+
+    static std::array<unsigned long long, 3> decode(unsigned long long code) {
+        using namespace morton_details;
+#if defined(__BMI2__)
+        return {{_pext_u64(code, MASK_3D), _pext_u64(code, MASK_3D << 1), _pext_u64(code, MASK_3D << 2)}};
+#else
+        return {{compact_by_2(code & MASK_3D), compact_by_2((code >> 1) & MASK_3D),
+                 compact_by_2((code >> 2) & MASK_3D)}};
+#endif
+    }
+};
+
 template <typename UIntTypeIn, std::size_t D, typename DepthType, typename UIntTypeOut = unsigned long long>
 UIntTypeOut get_morton_index(std::array<UIntTypeIn, D> const & anchor, DepthType depth) {
     static_assert(std::is_integral<UIntTypeIn>::value, "The given input type is not integral.");
@@ -20,15 +167,42 @@ UIntTypeOut get_morton_index(std::array<UIntTypeIn, D> const & anchor, DepthType
     for(std::size_t i{0}; i < D; ++i) assert(anchor[i] >= 0);
 #endif
 
-    UIntTypeOut morton_enc{depth & 0x1F};
-    unsigned int bit_position{5};
-    for (unsigned int dimension_bit_position{0}; dimension_bit_position < constants::Dmax; ++dimension_bit_position){
-        for (std::size_t dimension{0}; dimension < D; ++dimension){
-            morton_enc |= ( (anchor[dimension]>>dimension_bit_position) & 1ULL) << bit_position;
-            ++bit_position;
-        }
-    }
-    return morton_enc;
+    std::array<unsigned long long, D> coordinates;
+    for (std::size_t dimension{0}; dimension < D; ++dimension)
+        coordinates[dimension] = static_cast<unsigned long long>(anchor[dimension]);
+    return static_cast<UIntTypeOut>((MortonCodec<D>::encode(coordinates) << 5) | (depth & 0x1F));
 };
 
+/**
+ * Extract the depth stored in the 5 lowest bits of a Morton index.
+ * @tparam UIntTypeIn type of the Morton index.
+ * @param morton_index a Morton index computed by get_morton_index.
+ * @return the depth of the octant.
+ */
+template <typename UIntTypeIn>
+std::size_t get_depth_from_morton_index(UIntTypeIn morton_index) {
+    static_assert(std::is_integral<UIntTypeIn>::value, "The given input type is not integral.");
+    return static_cast<std::size_t>(morton_index & 0x1F);
+}
+
+/**
+ * Inverse of get_morton_index: de-interleave the bits of a Morton index to recover the anchor of the octant.
+ * @tparam UIntTypeOut type of the anchor coordinates.
+ * @tparam D           dimension of the anchor.
+ * @tparam UIntTypeIn  type of the Morton index.
+ * @param morton_index a Morton index computed by get_morton_index.
+ * @return the anchor of the octant.
+ */
+template <typename UIntTypeOut, std::size_t D, typename UIntTypeIn>
+std::array<UIntTypeOut, D> get_anchor_from_morton_index(UIntTypeIn morton_index) {
+    static_assert(std::is_integral<UIntTypeIn>::value, "The given input type is not integral.");
+    static_assert(std::is_integral<UIntTypeOut>::value, "The given output type is not integral.");
+
+    std::array<unsigned long long, D> const coordinates = MortonCodec<D>::decode(static_cast<unsigned long long>(morton_index) >> 5);
+    std::array<UIntTypeOut, D> anchor;
+    for (std::size_t dimension{0}; dimension < D; ++dimension)
+        anchor[dimension] = static_cast<UIntTypeOut>(coordinates[dimension]);
+    return anchor;
+}
+
 #endif //SWARMING_PROJECT_MORTON_INDEX_H
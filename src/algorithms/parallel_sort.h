@@ -0,0 +1,48 @@
+#ifndef SWARMING_PROJECT_PARALLEL_SORT_H
+#define SWARMING_PROJECT_PARALLEL_SORT_H
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <omp.h>
+
+#include "algorithms/merge_sorted_arrays.h"
+
+/**
+ * Number of elements under which parallel_sort falls back to std::sort: the threads would not have enough work.
+ */
+constexpr std::size_t PARALLEL_SORT_MIN_SIZE{1 << 14};
+
+/**
+ * Sort an array with several OpenMP threads: each thread sorts a chunk of the array with std::sort, then the
+ * chunks are merged with multiway_merge_parallel.
+ * @param array             the array to sort.
+ * @param comp              the comparator used to sort.
+ * @param number_of_threads the number of threads used, omp_get_max_threads() if 0.
+ */
+template <typename T, typename Comp = std::less<T>>
+static void parallel_sort(std::vector<T> & array, Comp comp = Comp(), int number_of_threads = 0) {
+    if(number_of_threads <= 0)
+        number_of_threads = omp_get_max_threads();
+    std::size_t const number_of_chunks{static_cast<std::size_t>(number_of_threads)};
+    if(number_of_chunks == 1 || array.size() < PARALLEL_SORT_MIN_SIZE) {
+        std::sort(array.begin(), array.end(), comp);
+        return;
+    }
+
+    std::vector< std::pair<typename std::vector<T>::iterator, typename std::vector<T>::iterator> >
+            chunks(number_of_chunks);
+    #pragma omp parallel for num_threads(number_of_threads) schedule(static, 1)
+    for(std::size_t chunk = 0; chunk < number_of_chunks; ++chunk) {
+        chunks[chunk].first  = array.begin() + array.size() * chunk / number_of_chunks;
+        chunks[chunk].second = array.begin() + array.size() * (chunk + 1) / number_of_chunks;
+        std::sort(chunks[chunk].first, chunks[chunk].second, comp);
+    }
+
+    std::vector<T> sorted(array.size());
+    multiway_merge_parallel(chunks, sorted.begin(), comp, number_of_threads);
+    array.swap(sorted);
+}
+
+#endif //SWARMING_PROJECT_PARALLEL_SORT_H
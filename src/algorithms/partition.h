@@ -3,11 +3,14 @@
 
 #include <functional>
 #include <algorithm>
+#include <iterator>
+#include <vector>
+#include <type_traits>
 
 #include "mpi.h"
 
 #include "definitions/constants.h"
-#include "algorithms/merge_sorted_arrays.h"
+#include "definitions/mpi_types.h"
 #include "algorithms/distributed_scan.h"
 
 #if SWARMING_DO_ALL_CHECKS == 1
@@ -16,6 +19,7 @@
 
 template <typename Container, typename StoredDataType = typename Container::value_type, typename UIntType = unsigned long long>
 void partition(Container & container, std::function<UIntType(StoredDataType const &)> weight) {
+    static_assert(std::is_integral<UIntType>::value, "The weights should be integers.");
 
 #if SWARMING_DO_ALL_CHECKS == 1
     assert(std::is_sorted(container.begin(), container.end()));
@@ -28,65 +32,54 @@ void partition(Container & container, std::function<UIntType(StoredDataType cons
     // Compute the distributed list of weights.
     auto const S = distributed_scan(container, weight);
 
-    // The last process broadcast the total number of octants to all the other process.
-    // Here we don't need to filter the process that will set the total_weight variable because the broadcast just
-    // after will override the incorrect values on all the process except the last one (which has the only correct value).
-    unsigned long long total_weight{S.back()};
-    MPI_Bcast(&total_weight, 1, MPI_UNSIGNED_LONG_LONG, process_number-1, MPI_COMM_WORLD);
-
-    // Compute useful constants that will help us to equally split the data across the processors.
-    float const mean_weight{static_cast<float>(total_weight) / process_number};
-    unsigned long long const k{total_weight % process_number};
-
+    // The total weight is the sum of the local weights: the local container, and so S, may be empty on any process.
+    UIntType const local_weight{S.empty() ? UIntType{0} : static_cast<UIntType>(S.back() - S.front() + weight(container.front()))};
+    UIntType total_weight{0};
+    MPI_Allreduce(&local_weight, &total_weight, 1, mpi_datatype<UIntType>(), MPI_SUM, MPI_COMM_WORLD);
+
+    // The first k processes receive q+1 units of weight, the others q. Each element goes to the process owning the
+    // first unit of its weight, so the destinations are computed once, from the prefix before each element, and are
+    // non-decreasing along the container.
+    std::size_t const P{static_cast<std::size_t>(process_number)};
+    UIntType const q{static_cast<UIntType>(total_weight / static_cast<UIntType>(P))};
+    UIntType const k{static_cast<UIntType>(total_weight % static_cast<UIntType>(P))};
+    auto const destination = [q, k, P](UIntType prefix) -> std::size_t {
+        if(prefix < k * (q + 1))
+            return static_cast<std::size_t>(prefix / (q + 1));
+        // Elements of zero weight after the last unit of weight stay on the last process.
+        if(q == 0)
+            return P - 1;
+        return std::min(static_cast<std::size_t>(k + (prefix - k * (q + 1)) / q), P - 1);
+    };
+
+    // Single pass: count the elements sent to each process and copy them in a contiguous buffer, already ordered by
+    // destination.
+    std::vector<int> send_counts(P, 0), send_displacements(P, 0), receive_counts(P), receive_displacements(P, 0);
     std::vector<StoredDataType> data_to_send;
-    std::vector<std::size_t> sizes;
     data_to_send.reserve(container.size());
-    sizes.reserve(static_cast<std::size_t>(process_number));
-
-    MPI_Request ignored_request;
-
-    for(int p{0}; p < process_number; ++p) {
-        auto container_it = container.begin();
-        auto const size_before = data_to_send.size();
-
-        for(std::size_t element_index{0}; element_index < container.size(); ++element_index, ++container_it) {
-            // If we should send this element to process p
-            if( (p < k &&
-                 p*(mean_weight+1) <= S[element_index] &&
-                 S[element_index] < (p+1)*(mean_weight+1))
-                ||
-                (p >= k &&
-                 p*mean_weight + k <= S[element_index] &&
-                 S[element_index] < (p+1)*mean_weight + k) ) {
-
-                // We store this element for sending it after
-                data_to_send.push_back(*container_it);
-            }
-        }
-        if(p == 0) sizes[p] = data_to_send.size();
-        else       sizes[p] = data_to_send.size() - sizes[p-1];
-        // Asynchronously send the data. The data (and the sizes) will not move in memory because:
-        //   1. We reserved enough space for the vectors, so it won't be reallocated.
-        //   2. The vectors were declared in the main scope, so they won't be destroyed until the end of the function.
-        MPI_Isend(&sizes[p], 1, MPI_UNSIGNED_LONG_LONG, p, /*tag*/0, MPI_COMM_WORLD, &ignored_request);
-        MPI_Isend(data_to_send.data() + size_before, sizes[p] * sizeof(StoredDataType),
-                  MPI_BYTE, p, /*tag*/ 1, MPI_COMM_WORLD, &ignored_request);
-    }
-
-    // Now we receive the data from all the process
-    std::vector< std::vector<StoredDataType> > received_data;
-    for(int p{0}; p < process_number; ++p) {
-        // First ask for the number of elements we will receive
-        std::size_t number_of_elements;
-        MPI_Recv(&number_of_elements, 1, MPI_UNSIGNED_LONG_LONG, p, /*tag*/0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-        // Prepare the memory place where we will receive the data
-        received_data.emplace_back(number_of_elements);
-        MPI_Recv(received_data.back().data(), number_of_elements * sizeof(StoredDataType),
-                 MPI_BYTE, p, /*tag*/ 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    std::size_t element_index{0};
+    for(auto const & element : container) {
+        UIntType const prefix{element_index == 0 ? S[0] - weight(element) : S[element_index - 1]};
+        ++send_counts[destination(prefix)];
+        data_to_send.push_back(element);
+        ++element_index;
     }
-    //std::cout << "1" << std::endl;
-    container = merge_sorted_arrays_sequential<StoredDataType, std::less<StoredDataType>, Container>(received_data);
-    //std::cout << "2" << std::endl;
+    for(std::size_t p{1}; p < P; ++p)
+        send_displacements[p] = send_displacements[p - 1] + send_counts[p - 1];
+
+    MPI_Alltoall(send_counts.data(), 1, MPI_INT, receive_counts.data(), 1, MPI_INT, MPI_COMM_WORLD);
+    for(std::size_t p{1}; p < P; ++p)
+        receive_displacements[p] = receive_displacements[p - 1] + receive_counts[p - 1];
+
+    // The elements received from the process p all precede the ones received from the process p+1, so the
+    // concatenation in rank order is sorted and no merge is needed.
+    std::vector<StoredDataType> received_data(static_cast<std::size_t>(receive_displacements.back() + receive_counts.back()));
+    MPI_Datatype const element_type{mpi_datatype<StoredDataType>()};
+    MPI_Alltoallv(data_to_send.data(), send_counts.data(), send_displacements.data(), element_type,
+                  received_data.data(), receive_counts.data(), receive_displacements.data(), element_type,
+                  MPI_COMM_WORLD);
+
+    container = Container(std::make_move_iterator(received_data.begin()), std::make_move_iterator(received_data.end()));
 };
 
 #endif //SWARMING_PROJECT_PARTITION_H
\ No newline at end of file
@@ -4,12 +4,12 @@
 #include <vector>
 #include <algorithm>
 #include <list>
+#include <iterator>
 
 #include "definitions/constants.h"
 #include "data_structures/Octree.h"
 #include "data_structures/Boid.h"
 #include "algorithms/block_partition.h"
-#include "algorithms/sorted_range_count_distributed.h"
 #include "algorithms/sample_sort.h"
 
 template <std::size_t Dimension>
@@ -23,16 +23,14 @@ std::vector< Octree<Dimension> > points2octree(std::vector< Boid<Dimension> > co
 
 
     // Creating the octants at the deepest level possible.
-    std::vector< Octree<Dimension> > F;
-    F.reserve(boids.size());
-    for(auto const & boid : boids)
-        F.emplace_back(boid);
+    std::vector< Octree<Dimension> > F = boid_octants(boids);
 
     // Sorting the created octants
     sample_sort_inplace(F);
 
 
-    // Partition blocks using BlockPartition algorithm.
+    // Partition blocks using BlockPartition algorithm. F is redistributed: the octants of F covered by the local
+    // blocks are now local.
     std::vector< Octree<Dimension> > B = block_partition(F);
 
     // Refining blocks until there are no more than Np_max boids per octant.
@@ -40,20 +38,21 @@ std::vector< Octree<Dimension> > points2octree(std::vector< Boid<Dimension> > co
     std::list< Octree<Dimension> > B_list(B.begin(), B.end());
     auto it = B_list.begin();
     while(it != B_list.end()) {
-        // Compute the number of boids covered by this octant.
-        // TODO: problem here.
-        std::size_t const number_of_points{ sorted_range_count_distributed(F, *it, it->get_dld()) };
+        // Compute the number of boids covered by this octant. All of them are local, and they are the octants of F
+        // between the octant and its deepest last descendant.
+        auto const first_point = std::lower_bound(F.begin(), F.end(), *it);
+        auto const last_point  = std::upper_bound(first_point, F.end(), it->get_dld());
+        std::size_t const number_of_points{ static_cast<std::size_t>(std::distance(first_point, last_point)) };
 
         // If this number is too high then split the octant.
-        if(number_of_points > Np_max) {
+        if(number_of_points > Np_max && it->m_depth < constants::Dmax) {
             auto const children = it->get_children();
             B_list.insert(B_list.end(), children.begin(), children.end());
-            auto const previous = std::prev(it);
-            B_list.erase(it);
-            it = previous;
+            it = B_list.erase(it);
         }
-        // Go to the next octant and loop.
-        ++it;
+        // Else go to the next octant.
+        else
+            ++it;
     }
 
     // Return the result as a vector.
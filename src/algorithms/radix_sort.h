@@ -0,0 +1,106 @@
+#ifndef SWARMING_PROJECT_RADIX_SORT_H
+#define SWARMING_PROJECT_RADIX_SORT_H
+
+#include <vector>
+#include <array>
+#include <utility>
+#include <omp.h>
+
+/**
+ * Tell whether the elements of type T can be sorted with radix_sort, and how to compute their key.
+ *
+ * The default is not sortable. A specialisation enabling radix_sort should define:
+ *  - static constexpr bool available{true};
+ *  - using key_type = an unsigned integral type;
+ *  - static constexpr unsigned KEY_BITS: the number of significant low bits of the keys;
+ *  - static key_type key(T const &): a key whose order is the order of operator<.
+ * @tparam T type of the elements to sort.
+ */
+template <typename T>
+struct RadixSortTraits {
+    static constexpr bool available{false};
+};
+
+/**
+ * Number of bits of the key sorted at each pass of radix_sort.
+ */
+constexpr unsigned RADIX_SORT_DIGIT_BITS{8};
+
+/**
+ * Sort an array with a parallel least-significant-digit radix sort on the keys given by RadixSortTraits<T>.
+ *
+ * The key of each element is computed once and sorted along with the element, so the elements are never compared.
+ * Each pass sorts RADIX_SORT_DIGIT_BITS bits of the keys with a stable counting sort: each thread counts the digits
+ * of a chunk, then scatters its chunk at the offsets given by the counts of all the threads. The passes on digits
+ * equal for all the keys are skipped.
+ * @param array             the array to sort.
+ * @param number_of_threads the number of threads used, omp_get_max_threads() if 0.
+ */
+template <typename T>
+static void radix_sort(std::vector<T> & array, int number_of_threads = 0) {
+    using Traits = RadixSortTraits<T>;
+    using Key    = typename Traits::key_type;
+    static_assert(Traits::available, "radix_sort needs a specialisation of RadixSortTraits.");
+    constexpr std::size_t NUMBER_OF_DIGITS{std::size_t{1} << RADIX_SORT_DIGIT_BITS};
+    constexpr Key DIGIT_MASK{NUMBER_OF_DIGITS - 1};
+
+    struct Item {
+        Key key;
+        T   value;
+    };
+
+    if(number_of_threads <= 0)
+        number_of_threads = omp_get_max_threads();
+    std::size_t const size{array.size()};
+    std::size_t const number_of_chunks{static_cast<std::size_t>(number_of_threads)};
+    if(size < 2)
+        return;
+
+    // Compute the keys, and the bits that differ between the keys.
+    std::vector<Item> items(size), buffer(size);
+    Key const first_key{Traits::key(array.front())};
+    Key varying_bits{0};
+    #pragma omp parallel for num_threads(number_of_threads) reduction(|:varying_bits)
+    for(std::size_t i = 0; i < size; ++i) {
+        items[i].key   = Traits::key(array[i]);
+        items[i].value = array[i];
+        varying_bits |= items[i].key ^ first_key;
+    }
+
+    std::vector< std::array<std::size_t, NUMBER_OF_DIGITS> > offsets(number_of_chunks);
+    for(unsigned shift{0}; shift < Traits::KEY_BITS; shift += RADIX_SORT_DIGIT_BITS) {
+        if(((varying_bits >> shift) & DIGIT_MASK) == 0)
+            continue;
+
+        #pragma omp parallel for num_threads(number_of_threads) schedule(static, 1)
+        for(std::size_t chunk = 0; chunk < number_of_chunks; ++chunk) {
+            offsets[chunk].fill(0);
+            for(std::size_t i{size * chunk / number_of_chunks}; i < size * (chunk + 1) / number_of_chunks; ++i)
+                ++offsets[chunk][(items[i].key >> shift) & DIGIT_MASK];
+        }
+
+        // The elements of a digit are placed by increasing chunk, so the sort is stable.
+        std::size_t offset{0};
+        for(std::size_t digit{0}; digit < NUMBER_OF_DIGITS; ++digit) {
+            for(std::size_t chunk{0}; chunk < number_of_chunks; ++chunk) {
+                std::size_t const count{offsets[chunk][digit]};
+                offsets[chunk][digit] = offset;
+                offset += count;
+            }
+        }
+
+        #pragma omp parallel for num_threads(number_of_threads) schedule(static, 1)
+        for(std::size_t chunk = 0; chunk < number_of_chunks; ++chunk) {
+            for(std::size_t i{size * chunk / number_of_chunks}; i < size * (chunk + 1) / number_of_chunks; ++i)
+                buffer[offsets[chunk][(items[i].key >> shift) & DIGIT_MASK]++] = items[i];
+        }
+        items.swap(buffer);
+    }
+
+    #pragma omp parallel for num_threads(number_of_threads)
+    for(std::size_t i = 0; i < size; ++i) {
+        array[i] = items[i].value;
+    }
+}
+
+#endif //SWARMING_PROJECT_RADIX_SORT_H
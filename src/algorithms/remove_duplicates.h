@@ -4,6 +4,7 @@
 #include <iterator>
 #include <functional>
 #include "definitions/constants.h"
+#include "definitions/mpi_types.h"
 #include "mpi.h"
 
 #if SWARMING_DO_ALL_CHECKS == 1
@@ -52,11 +53,11 @@ Container remove_duplicates(Container const & container,
     MPI_Request request;
     if(process_ID != 0)
         // Send the first element to the previous process.
-        MPI_Isend(&container_without_duplicates.front(), sizeof(StoredDataType), MPI_BYTE, process_ID-1, /*tag*/ 0, MPI_COMM_WORLD, &request);
+        MPI_Isend(&container_without_duplicates.front(), 1, mpi_datatype<StoredDataType>(), process_ID-1, /*tag*/ 0, MPI_COMM_WORLD, &request);
     if(process_ID != process_number-1) {
         StoredDataType next_element;
         // Receive the first element of the next process.
-        MPI_Recv(&next_element, sizeof(StoredDataType), MPI_BYTE, process_ID + 1, /*tag*/ 0, MPI_COMM_WORLD,
+        MPI_Recv(&next_element, 1, mpi_datatype<StoredDataType>(), process_ID + 1, /*tag*/ 0, MPI_COMM_WORLD,
                  MPI_STATUS_IGNORE);
         // And check if it is considered as a duplicate.
         if (is_duplicate(container_without_duplicates.back(), next_element))
@@ -13,11 +13,16 @@
 #include <numeric>
 #include <iterator>
 #include <list>
+#include <iostream>
 
 #include "mpi.h"
 
 #include "definitions/constants.h"
+#include "definitions/mpi_types.h"
 #include "algorithms/merge_sorted_arrays.h"
+#include "algorithms/exchange_and_merge.h"
+#include "algorithms/parallel_sort.h"
+#include "algorithms/radix_sort.h"
 
 #if SWARMING_SORT_USE_TIMER == 1
 
@@ -57,6 +62,54 @@ private:
 #endif
 
 
+/**
+ * Strategies available to send the buckets to their process in sample_sort_inplace.
+ */
+enum class BucketExchange {
+    POINT_TO_POINT, /**< One MPI_Isend and MPI_Irecv per bucket, merged as they arrive (see exchange_and_merge). */
+    ALLTOALLV,      /**< MPI_Alltoall of the bucket sizes, then MPI_Alltoallv of the buckets. */
+    IALLTOALLV      /**< As ALLTOALLV with MPI_Ialltoallv: the local bucket is copied during the exchange. */
+};
+
+/**
+ * Strategies available to select the splitters in sample_sort_inplace.
+ */
+enum class SplitterSelection {
+    GATHER,    /**< The process 0 gathers process_number-1 samples of each process, selects the splitters and
+                    broadcasts them: O(process_number^2) memory on the process 0. */
+    ALLGATHER, /**< Each process gathers samples_per_process samples of each process and selects the splitters
+                    locally, as weighted quantiles of the samples. */
+    HISTOGRAM  /**< As ALLGATHER, then the splitters whose global rank is too far from its target are refined with
+                    histograms of the global ranks of new candidates, until max_imbalance is reached. */
+};
+
+/**
+ * Parameters of sample_sort_inplace.
+ */
+struct SampleSortParameters {
+    BucketExchange    bucket_exchange{BucketExchange::ALLTOALLV};
+    SplitterSelection splitter_selection{SplitterSelection::HISTOGRAM};
+    /**
+     * Number of samples taken on each process by ALLGATHER and HISTOGRAM. The memory used on each process by the
+     * selection is O(process_number * samples_per_process).
+     */
+    std::size_t       samples_per_process{64};
+    /**
+     * Maximal ratio between the size of a bucket and the mean size targeted by HISTOGRAM. May not be reached when
+     * an element is repeated more than the tolerance allows.
+     */
+    double            max_imbalance{1.05};
+    /**
+     * Maximal number of refinement rounds of HISTOGRAM.
+     */
+    std::size_t       max_refinements{32};
+    /**
+     * Number of OpenMP threads used by each process to sort its array and to merge the buckets it receives,
+     * omp_get_max_threads() if 0. POINT_TO_POINT merges the buckets while they arrive, with a single thread.
+     */
+    int               number_of_threads{0};
+};
+
 template <typename T>
 static std::vector<T> select_evenly_spaced(std::vector<T> const & elements, std::size_t number_of_elements) {
     // Select number_of_elements in the vector elements.
@@ -78,18 +131,14 @@ static std::vector<T> select_evenly_spaced(std::vector<T> const & elements, std:
 }
 
 template <typename T, typename Comp>
-static std::vector<T> select_splitters(std::vector<T> & array, int process_ID, int process_number, Comp comp) {
+static std::vector<T> select_splitters_gather(std::vector<T> const & array, int process_ID, int process_number, Comp comp) {
 
     SWARMING_SORT_CONSTRUCT_TIMER(process_ID)
-    // Each process sort sequentially its array.
-    SWARMING_SORT_TIMER_TIC("sequential sort")
-    std::sort(array.begin(), array.end(), comp);
-    SWARMING_SORT_TIMER_TOC
 
-    // Then choose process_number-1 evenly-spaced elements and send them to the first process
+    // Choose process_number-1 evenly-spaced elements and send them to the first process
     std::vector<T> elements_to_send = select_evenly_spaced(array, process_number-1);
     if(process_ID > 0)
-        MPI_Send(elements_to_send.data(), elements_to_send.size() * sizeof(T), MPI_BYTE, 0, 0, MPI_COMM_WORLD);
+        MPI_Send(elements_to_send.data(), elements_to_send.size(), mpi_datatype<T>(), 0, 0, MPI_COMM_WORLD);
     // First we create the data structure that will store the splitters
     std::vector<T> selected_splitters(process_number-1);
 
@@ -107,7 +156,7 @@ static std::vector<T> select_splitters(std::vector<T> & array, int process_ID, i
         // other processes
         for(std::size_t p{1}; p < process_number; ++p) {
             received_data.emplace_back(process_number-1);
-            MPI_Recv(received_data.back().data(), (process_number-1) * sizeof(T), MPI_BYTE, p, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            MPI_Recv(received_data.back().data(), process_number-1, mpi_datatype<T>(), p, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
         }
         // The selected splitters are SORTED, so we can merge them efficiently
         const std::vector<T> sorted_all_splitters = merge_sorted_arrays_sequential(received_data, comp);
@@ -117,14 +166,378 @@ static std::vector<T> select_splitters(std::vector<T> & array, int process_ID, i
     }
     // The work of the process n°0 was to fill the splitters, now we can broadcast.
     SWARMING_SORT_TIMER_TIC("broadcast")
-    MPI_Bcast(selected_splitters.data(), selected_splitters.size() * sizeof(T), MPI_BYTE, /*root*/ 0, MPI_COMM_WORLD);
+    MPI_Bcast(selected_splitters.data(), selected_splitters.size(), mpi_datatype<T>(), /*root*/ 0, MPI_COMM_WORLD);
     SWARMING_SORT_TIMER_TOC
 
     return selected_splitters;
 }
 
+/**
+ * Gather samples of the sorted arrays of all the processes.
+ * @param array               the local sorted array.
+ * @param samples_per_process the number of evenly-spaced samples taken on each process (less if the local array
+ *                            is smaller).
+ * @param element_type        MPI datatype of an element of @a array.
+ * @param comp                the comparator used to sort @a array.
+ * @return the samples of all the processes sorted with @a comp, each one with its weight: the number of elements
+ *         of its process it represents.
+ */
+template <typename T, typename Comp>
+static std::vector< std::pair<T, double> > allgather_samples(std::vector<T> const & array,
+                                                            std::size_t samples_per_process,
+                                                            MPI_Datatype element_type, Comp comp) {
+    int process_number;
+    MPI_Comm_size(MPI_COMM_WORLD, &process_number);
+    std::size_t const P{static_cast<std::size_t>(process_number)};
+
+    int const number_of_samples{static_cast<int>(std::min(samples_per_process, array.size()))};
+    std::vector<T> local_samples;
+    local_samples.reserve(static_cast<std::size_t>(number_of_samples));
+    for(int j{0}; j < number_of_samples; ++j)
+        local_samples.push_back(array[static_cast<std::size_t>((j + 0.5) * array.size() / number_of_samples)]);
+    double const local_weight{number_of_samples > 0 ? static_cast<double>(array.size()) / number_of_samples : 0.0};
+
+    std::vector<int> counts(P), displacements(P + 1, 0);
+    std::vector<double> weights(P);
+    MPI_Allgather(&number_of_samples, 1, MPI_INT, counts.data(), 1, MPI_INT, MPI_COMM_WORLD);
+    MPI_Allgather(&local_weight, 1, MPI_DOUBLE, weights.data(), 1, MPI_DOUBLE, MPI_COMM_WORLD);
+    for(std::size_t p{0}; p < P; ++p)
+        displacements[p + 1] = displacements[p] + counts[p];
+
+    std::vector<T> samples(static_cast<std::size_t>(displacements.back()));
+    MPI_Allgatherv(local_samples.data(), number_of_samples, element_type,
+                   samples.data(), counts.data(), displacements.data(), element_type, MPI_COMM_WORLD);
+
+    std::vector< std::pair<T, double> > weighted_samples;
+    weighted_samples.reserve(samples.size());
+    for(std::size_t p{0}; p < P; ++p) {
+        for(int j{displacements[p]}; j < displacements[p + 1]; ++j)
+            weighted_samples.emplace_back(samples[static_cast<std::size_t>(j)], weights[p]);
+    }
+    std::stable_sort(weighted_samples.begin(), weighted_samples.end(),
+                     [&comp](std::pair<T, double> const & lhs, std::pair<T, double> const & rhs) {
+                         return comp(lhs.first, rhs.first);
+                     });
+    return weighted_samples;
+}
+
+/**
+ * Select the splitters as the weighted quantiles of samples of all the processes (SplitterSelection::ALLGATHER).
+ * @param array               the local sorted array.
+ * @param samples_per_process the number of samples taken on each process.
+ * @param element_type        MPI datatype of an element of @a array.
+ * @param comp                the comparator used to sort @a array.
+ * @return the process_number-1 sorted splitters, the same on all the processes.
+ */
+template <typename T, typename Comp>
+static std::vector<T> select_splitters_allgather(std::vector<T> const & array, std::size_t samples_per_process,
+                                                 MPI_Datatype element_type, Comp comp) {
+    int process_number;
+    MPI_Comm_size(MPI_COMM_WORLD, &process_number);
+
+    auto const samples = allgather_samples(array, samples_per_process, element_type, comp);
+    double total_weight{0.0};
+    for(auto const & sample : samples)
+        total_weight += sample.second;
+
+    // The splitter p is the first sample whose cumulated weight reaches the target of the bucket p.
+    std::vector<T> splitters;
+    splitters.reserve(static_cast<std::size_t>(process_number - 1));
+    double cumulated_weight{0.0};
+    std::size_t k{0};
+    for(int p{1}; p < process_number; ++p) {
+        double const target{total_weight * p / process_number};
+        while(k + 1 < samples.size() && cumulated_weight + samples[k].second < target)
+            cumulated_weight += samples[k++].second;
+        // Without any sample, all the arrays are empty and any splitter is valid.
+        splitters.push_back(samples.empty() ? T() : samples[k].first);
+    }
+    return splitters;
+}
+
+/**
+ * Select the splitters with a histogram refinement (SplitterSelection::HISTOGRAM): start from samples of all the
+ * processes and refine each splitter until its global rank (the number of elements not greater than it) is within
+ * a tolerance of its target p * N / process_number.
+ *
+ * A splitter out of tolerance keeps a bracket (lower, upper) of candidates whose rank is below and above the
+ * tolerance. At each round, each process proposes as new candidate the middle element of its local elements inside
+ * the bracket, and the global ranks of all the candidates are computed with a single MPI_Allreduce. At most
+ * samples_per_process splitters are refined per round, so the memory used per process stays
+ * O(process_number * samples_per_process).
+ * @param array        the local sorted array.
+ * @param parameters   the parameters of the sort.
+ * @param element_type MPI datatype of an element of @a array.
+ * @param comp         the comparator used to sort @a array.
+ * @return the process_number-1 sorted splitters, the same on all the processes.
+ */
+template <typename T, typename Comp>
+static std::vector<T> select_splitters_histogram(std::vector<T> const & array, SampleSortParameters const & parameters,
+                                                 MPI_Datatype element_type, Comp comp) {
+    int process_number;
+    MPI_Comm_size(MPI_COMM_WORLD, &process_number);
+    std::size_t const P{static_cast<std::size_t>(process_number)};
+
+    // Global rank of each candidate, computed with a local binary search and a sum over the processes.
+    auto const global_ranks = [&array, &comp](std::vector<T> const & candidates, std::vector<char> const & valid) {
+        std::vector<unsigned long long> ranks(candidates.size(), 0);
+        for(std::size_t c{0}; c < candidates.size(); ++c) {
+            if(valid[c])
+                ranks[c] = static_cast<unsigned long long>(
+                        std::upper_bound(array.begin(), array.end(), candidates[c], comp) - array.begin());
+        }
+        MPI_Allreduce(MPI_IN_PLACE, ranks.data(), static_cast<int>(ranks.size()), MPI_UNSIGNED_LONG_LONG, MPI_SUM,
+                      MPI_COMM_WORLD);
+        return ranks;
+    };
+
+    unsigned long long const local_size{array.size()};
+    unsigned long long total_size;
+    MPI_Allreduce(&local_size, &total_size, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    double const tolerance{(parameters.max_imbalance - 1.0) * total_size / P / 2.0};
+
+    struct SplitterState {
+        double             target;
+        bool               has_lower{false}, has_upper{false}, has_best{false};
+        T                  lower, upper, best;
+        unsigned long long lower_rank{0}, upper_rank{0}, best_rank{0};
+        bool               resolved{false};
+    };
+    std::vector<SplitterState> states(P - 1);
+    for(std::size_t p{1}; p < P; ++p)
+        states[p - 1].target = static_cast<double>(total_size) * p / P;
+
+    // Take the candidate into account in the state of a splitter.
+    auto const update = [tolerance](SplitterState & state, T const & candidate, unsigned long long rank) {
+        double const distance{std::abs(static_cast<double>(rank) - state.target)};
+        if(!state.has_best || distance < std::abs(static_cast<double>(state.best_rank) - state.target)) {
+            state.best = candidate; state.best_rank = rank; state.has_best = true;
+        }
+        if(distance <= tolerance)
+            state.resolved = true;
+        else if(rank < state.target && (!state.has_lower || rank > state.lower_rank)) {
+            state.lower = candidate; state.lower_rank = rank; state.has_lower = true;
+        }
+        else if(rank > state.target && (!state.has_upper || rank < state.upper_rank)) {
+            state.upper = candidate; state.upper_rank = rank; state.has_upper = true;
+        }
+    };
+
+    // First round: the samples of all the processes are the candidates of all the splitters.
+    {
+        auto const samples = allgather_samples(array, parameters.samples_per_process, element_type, comp);
+        std::vector<T> candidates;
+        candidates.reserve(samples.size());
+        for(auto const & sample : samples)
+            candidates.push_back(sample.first);
+        auto const ranks = global_ranks(candidates, std::vector<char>(candidates.size(), 1));
+        // The ranks of the sorted candidates are sorted: only the two candidates around the target matter.
+        for(auto & state : states) {
+            auto const next = std::lower_bound(ranks.begin(), ranks.end(), state.target,
+                                               [](unsigned long long rank, double target) { return rank < target; });
+            std::size_t const k{static_cast<std::size_t>(next - ranks.begin())};
+            if(k < ranks.size())
+                update(state, candidates[k], ranks[k]);
+            if(k > 0)
+                update(state, candidates[k - 1], ranks[k - 1]);
+        }
+    }
+
+    // Refinement rounds on the splitters still out of tolerance.
+    std::size_t const batch_size{std::max<std::size_t>(parameters.samples_per_process, 1)};
+    for(std::size_t round{0}; round < parameters.max_refinements; ++round) {
+        std::vector<std::size_t> batch;
+        for(std::size_t i{0}; i < states.size() && batch.size() < batch_size; ++i) {
+            if(!states[i].resolved)
+                batch.push_back(i);
+        }
+        if(batch.empty())
+            break;
+
+        // Local candidates: the middle of the local elements strictly inside the bracket of each splitter.
+        std::vector<T>    local_candidates(batch.size());
+        std::vector<char> local_valid(batch.size(), 0);
+        for(std::size_t b{0}; b < batch.size(); ++b) {
+            SplitterState const & state = states[batch[b]];
+            auto const first = state.has_lower ? std::upper_bound(array.begin(), array.end(), state.lower, comp)
+                                               : array.begin();
+            auto const last  = state.has_upper ? std::lower_bound(first, array.end(), state.upper, comp)
+                                               : array.end();
+            if(first < last) {
+                local_candidates[b] = *(first + (last - first) / 2);
+                local_valid[b]      = 1;
+            }
+        }
+        std::vector<T>    candidates(batch.size() * P);
+        std::vector<char> valid(batch.size() * P);
+        MPI_Allgather(local_candidates.data(), static_cast<int>(batch.size()), element_type,
+                      candidates.data(), static_cast<int>(batch.size()), element_type, MPI_COMM_WORLD);
+        MPI_Allgather(local_valid.data(), static_cast<int>(batch.size()), MPI_CHAR,
+                      valid.data(), static_cast<int>(batch.size()), MPI_CHAR, MPI_COMM_WORLD);
+        auto const ranks = global_ranks(candidates, valid);
+
+        for(std::size_t b{0}; b < batch.size(); ++b) {
+            SplitterState & state = states[batch[b]];
+            bool any_candidate{false};
+            for(std::size_t p{0}; p < P; ++p) {
+                std::size_t const c{p * batch.size() + b};
+                if(valid[c]) {
+                    update(state, candidates[c], ranks[c]);
+                    any_candidate = true;
+                }
+            }
+            // No element is left inside the bracket: the best candidate is the best possible splitter.
+            if(!any_candidate)
+                state.resolved = true;
+        }
+    }
+
+    std::vector<T> splitters;
+    splitters.reserve(states.size());
+    for(auto const & state : states) {
+        // Without any candidate, all the arrays are empty and any splitter is valid.
+        splitters.push_back(state.has_best ? state.best : T());
+    }
+    // With many equal elements, the best candidates may not be ordered like the targets.
+    std::sort(splitters.begin(), splitters.end(), comp);
+    return splitters;
+}
+
+/**
+ * Select the splitters of the sample sort with the strategy chosen in the parameters.
+ * @param array      the local sorted array.
+ * @param parameters the parameters of the sort.
+ * @param comp       the comparator used to sort @a array.
+ * @return the sorted splitters, the same on all the processes.
+ */
+template <typename T, typename Comp>
+static std::vector<T> select_splitters(std::vector<T> const & array, SampleSortParameters const & parameters,
+                                       Comp comp) {
+    int process_ID, process_number;
+    MPI_Comm_size(MPI_COMM_WORLD, &process_number);
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_ID);
+
+    if(parameters.splitter_selection == SplitterSelection::GATHER)
+        return select_splitters_gather(array, process_ID, process_number, comp);
+
+    MPI_Datatype const element_type{mpi_datatype<T>()};
+    return parameters.splitter_selection == SplitterSelection::ALLGATHER
+           ? select_splitters_allgather(array, parameters.samples_per_process, element_type, comp)
+           : select_splitters_histogram(array, parameters, element_type, comp);
+}
+
+/**
+ * Compute the limits of the buckets of a sorted array.
+ * @param array     the sorted array.
+ * @param splitters the process_number-1 sorted splitters.
+ * @param comp      the comparator used to sort @a array.
+ * @return the process_number+1 limits: the bucket p (sent to the process p) is [limits[p], limits[p+1]) and
+ *         contains the elements greater than the splitter p-1 and not greater than the splitter p.
+ */
+template <typename T, typename Comp>
+static std::vector<std::size_t> bucket_limits(std::vector<T> const & array, std::vector<T> const & splitters, Comp comp) {
+    std::vector<std::size_t> limits{0};
+    limits.reserve(splitters.size() + 2);
+    for(auto const & splitter : splitters)
+        limits.push_back(static_cast<std::size_t>(
+                std::upper_bound(array.begin() + limits.back(), array.end(), splitter, comp) - array.begin()));
+    limits.push_back(array.size());
+    return limits;
+}
+
+/**
+ * Send each bucket of a sorted array to its process with a collective MPI_Alltoallv (or MPI_Ialltoallv), and merge
+ * the buckets received.
+ *
+ * The buckets are received in a single buffer, in rank order, and merged back in @a array.
+ * @param array             the sorted array, replaced by the merge of the buckets received.
+ * @param limits            the limits of the buckets (see bucket_limits).
+ * @param comp              the comparator used to sort @a array.
+ * @param nonblocking       if true, use MPI_Ialltoallv and copy the bucket of this process during the exchange.
+ * @param number_of_threads the number of threads used by the merge, omp_get_max_threads() if 0.
+ */
+template <typename T, typename Comp>
+static void exchange_buckets_alltoallv(std::vector<T> & array, std::vector<std::size_t> const & limits, Comp comp,
+                                       bool nonblocking, int number_of_threads) {
+    int process_ID, process_number;
+    MPI_Comm_size(MPI_COMM_WORLD, &process_number);
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_ID);
+    std::size_t const P{static_cast<std::size_t>(process_number)};
+
+    MPI_Datatype const element_type{mpi_datatype<T>()};
+
+    std::vector<int> send_counts(P), send_displacements(P), receive_counts(P), receive_displacements(P + 1, 0);
+    for(std::size_t p{0}; p < P; ++p) {
+        send_counts[p]        = static_cast<int>(limits[p + 1] - limits[p]);
+        send_displacements[p] = static_cast<int>(limits[p]);
+    }
+    MPI_Alltoall(send_counts.data(), 1, MPI_INT, receive_counts.data(), 1, MPI_INT, MPI_COMM_WORLD);
+    for(std::size_t p{0}; p < P; ++p)
+        receive_displacements[p + 1] = receive_displacements[p] + receive_counts[p];
+
+    std::vector<T> received_data(static_cast<std::size_t>(receive_displacements.back()));
+    if(nonblocking) {
+        // The bucket of this process does not go through MPI: it is copied while the other buckets are exchanged.
+        std::size_t const self{static_cast<std::size_t>(process_ID)};
+        int const own_count{send_counts[self]};
+        send_counts[self] = receive_counts[self] = 0;
+        MPI_Request request;
+        MPI_Ialltoallv(array.data(), send_counts.data(), send_displacements.data(), element_type,
+                       received_data.data(), receive_counts.data(), receive_displacements.data(), element_type,
+                       MPI_COMM_WORLD, &request);
+        std::copy(array.begin() + limits[self], array.begin() + limits[self] + own_count,
+                  received_data.begin() + receive_displacements[self]);
+        MPI_Wait(&request, MPI_STATUS_IGNORE);
+    }
+    else {
+        MPI_Alltoallv(array.data(), send_counts.data(), send_displacements.data(), element_type,
+                      received_data.data(), receive_counts.data(), receive_displacements.data(), element_type,
+                      MPI_COMM_WORLD);
+    }
+
+    std::vector< std::pair<typename std::vector<T>::const_iterator, typename std::vector<T>::const_iterator> > runs;
+    for(std::size_t p{0}; p < P; ++p)
+        runs.emplace_back(received_data.cbegin() + receive_displacements[p],
+                          received_data.cbegin() + receive_displacements[p + 1]);
+    array.resize(received_data.size());
+    multiway_merge_parallel(runs, array.begin(), comp, number_of_threads);
+}
+
+/**
+ * Sort the local array of a process with a comparison sort.
+ * @param array             the array to sort.
+ * @param comp              the comparator used to sort.
+ * @param number_of_threads the number of threads used, omp_get_max_threads() if 0.
+ */
+template <typename T, typename Comp>
+static typename std::enable_if<!(RadixSortTraits<T>::available && std::is_same<Comp, std::less<T>>::value)>::type
+local_sort(std::vector<T> & array, Comp comp, int number_of_threads) {
+    parallel_sort(array, comp, number_of_threads);
+}
+
+/**
+ * Sort the local array of a process with a radix sort, when the elements have a key compatible with std::less
+ * (see RadixSortTraits), e.g. the octants.
+ * @param array             the array to sort.
+ * @param number_of_threads the number of threads used, omp_get_max_threads() if 0.
+ */
+template <typename T, typename Comp>
+static typename std::enable_if<RadixSortTraits<T>::available && std::is_same<Comp, std::less<T>>::value>::type
+local_sort(std::vector<T> & array, Comp, int number_of_threads) {
+    radix_sort(array, number_of_threads);
+}
+
+/**
+ * Sort an array distributed over all the processes of MPI_COMM_WORLD with a sample sort. Should be called by all
+ * the processes.
+ * @param array      the local part of the array. At the end, the local arrays are sorted and all the elements of
+ *                   the process p are not greater than the elements of the process p+1.
+ * @param comp       the comparator used to sort.
+ * @param parameters the strategies used by the sort.
+ */
 template <typename T, typename Comp = std::less<T>>
-static void sample_sort_inplace(std::vector<T> & array, Comp comp = Comp()) {
+static void sample_sort_inplace(std::vector<T> & array, Comp comp = Comp(),
+                                SampleSortParameters const & parameters = SampleSortParameters()) {
 
     int process_ID, process_number;
 
@@ -140,53 +553,33 @@ static void sample_sort_inplace(std::vector<T> & array, Comp comp = Comp()) {
 
     SWARMING_SORT_CONSTRUCT_TIMER(process_ID)
 
-    // Select the splitters.
-    std::vector<T> selected_splitters = select_splitters(array, process_ID, process_number, comp);
-
-    // For the following code, it is easier to add a last splitter that will be +infinity (or a value bigger than every
-    // other value possible in the array
-    selected_splitters.push_back(std::numeric_limits<T>::max());
+    // Each process sort its array with its threads.
+    SWARMING_SORT_TIMER_TIC("local sort")
+    local_sort(array, comp, parameters.number_of_threads);
+    SWARMING_SORT_TIMER_TOC
 
-    // And now each process sends its data to the process that should manage them.
-    std::vector<std::size_t> index_delimitation{0};            // Stores the indexes where we splitted the buckets.
-    std::vector<std::size_t> sizes(selected_splitters.size()); // Stored the number of elements of each bucket.
-    // Important because we don't want a reallocation (asynchronous communications).
-    MPI_Request              ignored_request;                  // We perform synchronous MPI_Recv so we don't need to wait for the asynchronous request.
-    std::size_t              bucket_index{0};                  // Index of the current bucket (i.e. index of the processor that should handle it).
-    SWARMING_SORT_TIMER_TIC("sending buckets")
-    for(std::size_t i{0}; i < array.size(); ++i) {
-        // If we enter in a new bucket, than send the data and update the bucket index
-        if(array[i] > selected_splitters[bucket_index]) {
-            sizes.emplace_back(i - index_delimitation.back());
-            MPI_Isend(&(sizes.back()), 1, MPI_UNSIGNED_LONG_LONG, bucket_index, /*tag*/ 0, MPI_COMM_WORLD, &ignored_request);
-            MPI_Isend(array.data() + index_delimitation.back(), sizes.back() * sizeof(T), MPI_BYTE, bucket_index, /*tag*/ 1, MPI_COMM_WORLD, &ignored_request);
-            index_delimitation.emplace_back(i);
-            ++bucket_index;
-        }
-    }
-    // The last bucket has not been sent in the loop, so we need to send it now.
-    const std::size_t buffer_size{array.size() - index_delimitation.back()};
-    MPI_Isend(&buffer_size, 1, MPI_UNSIGNED_LONG_LONG, bucket_index, /*tag*/ 0, MPI_COMM_WORLD, &ignored_request);
-    MPI_Isend(array.data() + index_delimitation.back(), buffer_size * sizeof(T), MPI_BYTE, bucket_index, /*tag*/ 1, MPI_COMM_WORLD, &ignored_request);
+    // Select the splitters.
+    SWARMING_SORT_TIMER_TIC("splitter selection")
+    std::vector<T> const selected_splitters = select_splitters(array, parameters, comp);
     SWARMING_SORT_TIMER_TOC
 
+    // The array is sorted, so the limits of the buckets are found by binary search.
+    std::vector<std::size_t> const limits = bucket_limits(array, selected_splitters, comp);
 
-    // Each process should receive its data from all the other process.
-    SWARMING_SORT_TIMER_TIC("receiving buckets")
-    std::vector< std::vector<T> > final_data;
-    for(std::size_t p{0}; p < process_number; ++p) {
-        std::size_t size_to_receive;
-        MPI_Recv(&size_to_receive, 1, MPI_UNSIGNED_LONG_LONG, p, /*tag*/ 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-        final_data.emplace_back(size_to_receive);
-        MPI_Recv(final_data.back().data(), size_to_receive * sizeof(T), MPI_BYTE, p, /*tag*/ 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    // And now each process sends its data to the process that should manage them.
+    SWARMING_SORT_TIMER_TIC("exchanging and merging buckets")
+    switch(parameters.bucket_exchange) {
+        case BucketExchange::POINT_TO_POINT:
+            exchange_and_merge_inplace(array, limits, comp);
+            break;
+        case BucketExchange::IALLTOALLV:
+            exchange_buckets_alltoallv(array, limits, comp, true, parameters.number_of_threads);
+            break;
+        case BucketExchange::ALLTOALLV:
+        default:
+            exchange_buckets_alltoallv(array, limits, comp, false, parameters.number_of_threads);
     }
     SWARMING_SORT_TIMER_TOC
-
-    //MPI_Barrier(MPI_COMM_WORLD);
-    // Finally, the received data is sorted so we can merge it efficiently.
-    SWARMING_SORT_TIMER_TIC("merging received data")
-    array = merge_sorted_arrays_sequential(final_data, comp);
-    SWARMING_SORT_TIMER_TOC
 }
 
 #undef SWARMING_SORT_CONSTRUCT_TIMER
@@ -6,6 +6,7 @@
 
 #include "mpi.h"
 #include "definitions/constants.h"
+#include "definitions/mpi_types.h"
 
 #if SWARMING_DO_ALL_CHECKS == 1
 #include <cassert>
@@ -27,7 +28,8 @@ std::size_t sorted_count_distributed(Container const & distributed_container,
 
     // Then do a distributed sum on this local number.
     std::size_t distributed_number_of_elements;
-    MPI_Allreduce(&local_number_of_elements, &distributed_number_of_elements, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(&local_number_of_elements, &distributed_number_of_elements, 1, mpi_datatype<std::size_t>(), MPI_SUM,
+                  MPI_COMM_WORLD);
 
     // And all the processes return this number.
     return distributed_number_of_elements;
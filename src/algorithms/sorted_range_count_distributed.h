@@ -7,6 +7,7 @@
 
 #include "mpi.h"
 #include "definitions/constants.h"
+#include "definitions/mpi_types.h"
 
 #if SWARMING_DO_ALL_CHECKS == 1
 #include <cassert>
@@ -46,7 +47,7 @@ std::size_t sorted_range_count_distributed(Container const & distributed_contain
 #endif
 
     std::array< StoredDataType, 2 > bounds = {lhs, rhs};
-    MPI_Bcast(bounds.data(), 2 * sizeof(StoredDataType), MPI_BYTE, root, MPI_COMM_WORLD);
+    MPI_Bcast(bounds.data(), 2, mpi_datatype<StoredDataType>(), root, MPI_COMM_WORLD);
 
     // Compute first the local number of value_to_search.
     auto const lower_bound = std::lower_bound(distributed_container.begin(), distributed_container.end(), bounds[0], comp);
@@ -56,7 +57,8 @@ std::size_t sorted_range_count_distributed(Container const & distributed_contain
 
     // Then do a distributed sum on this local number.
     std::size_t distributed_number_of_elements{0};
-    MPI_Reduce(&local_number_of_elements, &distributed_number_of_elements, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, root, MPI_COMM_WORLD);
+    MPI_Reduce(&local_number_of_elements, &distributed_number_of_elements, 1, mpi_datatype<std::size_t>(), MPI_SUM, root,
+               MPI_COMM_WORLD);
 
     // And all the process return.
     // The root process return the answer, the other processes return 0.
@@ -0,0 +1,130 @@
+#include <iostream>
+#include <vector>
+#include <array>
+#include <chrono>
+#include <random>
+
+#include "data_structures/MathArray.h"
+
+/*
+ * Micro-benchmark of the MathArray arithmetic.
+ *
+ * The same boid-like update (velocity and position integration, then a force combining three terms) is computed
+ * with the expression templates of MathArray and with eager operators that return a new array for each operation,
+ * which was the previous implementation of MathArray.
+ */
+
+/**
+ * Array whose operators eagerly compute a new array, as MathArray did before the expression templates.
+ */
+template <typename T, std::size_t S>
+struct EagerArray : public std::array<T, S> {
+
+    EagerArray<T, S> operator+=(const EagerArray<T, S> & array) {
+        for(std::size_t i{0}; i < S; ++i) (*this)[i] += array[i];
+        return *this;
+    }
+
+    EagerArray<T, S> operator-=(const EagerArray<T, S> & array) {
+        for(std::size_t i{0}; i < S; ++i) (*this)[i] -= array[i];
+        return *this;
+    }
+
+    EagerArray<T, S> operator*=(const T & element) {
+        for(std::size_t i{0}; i < S; ++i) (*this)[i] *= element;
+        return *this;
+    }
+};
+
+template <typename T, std::size_t S>
+EagerArray<T, S> operator+(const EagerArray<T, S> & lhs, const EagerArray<T, S> & rhs) {
+    EagerArray<T, S> copy(lhs);
+    copy += rhs;
+    return copy;
+}
+
+template <typename T, std::size_t S>
+EagerArray<T, S> operator-(const EagerArray<T, S> & lhs, const EagerArray<T, S> & rhs) {
+    EagerArray<T, S> copy(lhs);
+    copy -= rhs;
+    return copy;
+}
+
+template <typename T, std::size_t S>
+EagerArray<T, S> operator*(T lhs, const EagerArray<T, S> & rhs) {
+    EagerArray<T, S> copy(rhs);
+    copy *= lhs;
+    return copy;
+}
+
+/**
+ * Update the given arrays with the boid-like update described above, and return the time taken in nanoseconds per
+ * updated element.
+ * @tparam Array type of the arrays, either MathArray or EagerArray.
+ */
+template <typename Array>
+double time_update(std::vector<Array> & positions, std::vector<Array> & velocities, std::vector<Array> & forces,
+                   Array const & center, std::size_t number_of_steps) {
+    using T = typename Array::value_type;
+    T const timestep{0.01f}, cohesion{0.1f}, separation{0.2f}, alignment{0.3f};
+
+    auto const start = std::chrono::steady_clock::now();
+    for(std::size_t step{0}; step < number_of_steps; ++step) {
+        for(std::size_t i{0}; i < positions.size(); ++i) {
+            forces[i] = cohesion * (center - positions[i]) - separation * (positions[i] - center)
+                        + alignment * velocities[i];
+            velocities[i] += timestep * forces[i];
+            positions[i]  += timestep * velocities[i];
+        }
+    }
+    auto const end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count()
+           / static_cast<double>(number_of_steps * positions.size());
+}
+
+/**
+ * Run the benchmark for arrays of size S and print the results.
+ */
+template <std::size_t S>
+void run_benchmark(std::size_t number_of_arrays, std::size_t number_of_steps) {
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+
+    std::vector< MathArray<float, S> >  positions(number_of_arrays), velocities(number_of_arrays), forces(number_of_arrays);
+    std::vector< EagerArray<float, S> > eager_positions(number_of_arrays), eager_velocities(number_of_arrays),
+                                        eager_forces(number_of_arrays);
+    MathArray<float, S>  center(0.5f);
+    EagerArray<float, S> eager_center;
+    eager_center.fill(0.5f);
+    for(std::size_t i{0}; i < number_of_arrays; ++i) {
+        for(std::size_t d{0}; d < S; ++d) {
+            eager_positions[i][d]  = positions[i][d]  = distribution(generator);
+            eager_velocities[i][d] = velocities[i][d] = distribution(generator);
+        }
+    }
+
+    double const eager_time{time_update(eager_positions, eager_velocities, eager_forces, eager_center, number_of_steps)};
+    double const expression_time{time_update(positions, velocities, forces, center, number_of_steps)};
+
+    // Check that both versions computed the same values (and prevent the compiler from removing the computations).
+    float max_difference{0.0f};
+    for(std::size_t i{0}; i < number_of_arrays; ++i) {
+        for(std::size_t d{0}; d < S; ++d) {
+            float const difference{positions[i][d] - eager_positions[i][d]};
+            max_difference = std::max(max_difference, difference < 0 ? -difference : difference);
+        }
+    }
+
+    std::cout << "D=" << S << ": eager " << eager_time << " ns/update, expression templates " << expression_time
+              << " ns/update, speed-up " << eager_time / expression_time << " (max difference "
+              << max_difference << ")" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    constexpr const std::size_t NUMBER_OF_ARRAYS{10000};
+    constexpr const std::size_t NUMBER_OF_STEPS{1000};
+
+    run_benchmark<2>(NUMBER_OF_ARRAYS, NUMBER_OF_STEPS);
+    run_benchmark<3>(NUMBER_OF_ARRAYS, NUMBER_OF_STEPS);
+    return 0;
+}
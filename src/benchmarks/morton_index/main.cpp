@@ -0,0 +1,117 @@
+#include <iostream>
+#include <random>
+#include <vector>
+#include <array>
+#include <cstdlib>
+#include <omp.h>
+
+#include "mpi.h"
+#include "algorithms/morton_index.h"
+#include "data_structures/Octree.h"
+
+/*
+ * Benchmark of the Morton encoding and decoding: the throughput, in millions of keys per second, of the bit by bit
+ * interleaving that get_morton_index used to perform, of MortonCodec (PDEP / PEXT if the compiler targets BMI2, magic
+ * bits otherwise), and of boid_octants, which builds the leaf octant of each boid for points2octree.
+ *
+ * Usage: ./main [SIZE] [REPETITIONS]
+ */
+
+/**
+ * Interleave the bits of the anchor one by one, as get_morton_index used to.
+ */
+template <std::size_t D>
+static unsigned long long reference_encode(std::array<unsigned long long, D> const & anchor) {
+    unsigned long long code{0};
+    unsigned int bit_position{0};
+    for (unsigned int dimension_bit_position{0}; dimension_bit_position < constants::Dmax; ++dimension_bit_position)
+        for (std::size_t dimension{0}; dimension < D; ++dimension)
+            code |= ((anchor[dimension] >> dimension_bit_position) & 1ULL) << bit_position++;
+    return code;
+}
+
+/**
+ * Print the throughput of a benchmark.
+ * @param name        name of the benchmark.
+ * @param size        number of keys computed at each repetition.
+ * @param repetitions number of repetitions.
+ * @param seconds     total time of the repetitions.
+ * @param checksum    value computed from the results, printed so that the computation is not optimised away.
+ */
+static void report(std::string const & name, std::size_t size, std::size_t repetitions, double seconds,
+                   unsigned long long checksum) {
+    std::cout << name << ": " << size * repetitions / seconds / 1e6 << " Mkeys/s (checksum " << checksum << ")"
+              << std::endl;
+}
+
+template <std::size_t D>
+static void benchmark(std::size_t size, std::size_t repetitions) {
+    std::mt19937_64 generator(constants::DEFAULT_SEED);
+    std::uniform_int_distribution<unsigned long long> coordinate(0, (1ULL << constants::Dmax) - 1);
+    std::vector<std::array<unsigned long long, D>> anchors(size);
+    for(auto & anchor : anchors)
+        for(auto & c : anchor)
+            c = coordinate(generator);
+    std::vector<unsigned long long> codes(size);
+
+    std::cout << "Dimension " << D << std::endl;
+
+    double start{omp_get_wtime()};
+    for(std::size_t repetition{0}; repetition < repetitions; ++repetition)
+        for(std::size_t i{0}; i < size; ++i)
+            codes[i] = reference_encode<D>(anchors[i]);
+    report("  bit by bit encode", size, repetitions, omp_get_wtime() - start, codes[size / 2]);
+    std::vector<unsigned long long> const expected(codes);
+
+    start = omp_get_wtime();
+    for(std::size_t repetition{0}; repetition < repetitions; ++repetition)
+        for(std::size_t i{0}; i < size; ++i)
+            codes[i] = MortonCodec<D>::encode(anchors[i]);
+    report("  MortonCodec encode", size, repetitions, omp_get_wtime() - start, codes[size / 2]);
+    if(codes != expected)
+        std::cout << "  ERROR: MortonCodec::encode differs from the bit by bit encoding" << std::endl;
+
+    unsigned long long checksum{0};
+    bool decoded{true};
+    start = omp_get_wtime();
+    for(std::size_t repetition{0}; repetition < repetitions; ++repetition)
+        for(std::size_t i{0}; i < size; ++i) {
+            std::array<unsigned long long, D> const anchor = MortonCodec<D>::decode(codes[i]);
+            checksum += anchor[0];
+            decoded = decoded && anchor == anchors[i];
+        }
+    report("  MortonCodec decode", size, repetitions, omp_get_wtime() - start, checksum);
+    if(!decoded)
+        std::cout << "  ERROR: MortonCodec::decode is not the inverse of MortonCodec::encode" << std::endl;
+
+    std::uniform_real_distribution<float> position(0.0f, static_cast<float>(GRID_SIZE));
+    std::vector<Boid<D>> boids;
+    boids.reserve(size);
+    for(std::size_t i{0}; i < size; ++i) {
+        Position<D> p;
+        for(auto & c : p)
+            c = position(generator);
+        boids.emplace_back(p, Velocity<D>(0.0f), Force<D>(0.0f));
+    }
+    checksum = 0;
+    start = omp_get_wtime();
+    for(std::size_t repetition{0}; repetition < repetitions; ++repetition)
+        checksum += boid_octants(boids)[size / 2].morton_index();
+    report("  boid_octants", size, repetitions, omp_get_wtime() - start, checksum);
+}
+
+int main(int argc, char ** argv) {
+    MPI_Init(&argc, &argv);
+    std::size_t const size{argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1ULL << 22};
+    std::size_t const repetitions{argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10};
+
+#if defined(__BMI2__)
+    std::cout << "MortonCodec uses PDEP / PEXT" << std::endl;
+#else
+    std::cout << "MortonCodec uses magic bits" << std::endl;
+#endif
+    benchmark<2>(size, repetitions);
+    benchmark<3>(size, repetitions);
+    MPI_Finalize();
+    return EXIT_SUCCESS;
+}
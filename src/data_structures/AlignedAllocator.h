@@ -0,0 +1,54 @@
+#ifndef SWARMING_PROJECT_ALIGNEDALLOCATOR_H
+#define SWARMING_PROJECT_ALIGNEDALLOCATOR_H
+
+#include <cstdlib>
+#include <cstddef>
+#include <new>
+
+/**
+ * Minimal allocator returning memory aligned on @a Alignment bytes.
+ *
+ * Used to store the arrays processed by the vectorised kernels, so that aligned SIMD loads can be used.
+ * @tparam T         type of the allocated elements.
+ * @tparam Alignment alignment of the allocated memory, in bytes. Should be a power of 2 multiple of sizeof(void*).
+ */
+template <typename T, std::size_t Alignment>
+class AlignedAllocator {
+
+public:
+
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() = default;
+
+    template <typename U>
+    AlignedAllocator(AlignedAllocator<U, Alignment> const &) { }
+
+    T * allocate(std::size_t number_of_elements) {
+        void * memory{nullptr};
+        if(posix_memalign(&memory, Alignment, number_of_elements * sizeof(T)) != 0)
+            throw std::bad_alloc();
+        return static_cast<T *>(memory);
+    }
+
+    void deallocate(T * memory, std::size_t) {
+        std::free(memory);
+    }
+};
+
+template <typename T, typename U, std::size_t Alignment>
+bool operator==(AlignedAllocator<T, Alignment> const &, AlignedAllocator<U, Alignment> const &) {
+    return true;
+}
+
+template <typename T, typename U, std::size_t Alignment>
+bool operator!=(AlignedAllocator<T, Alignment> const &, AlignedAllocator<U, Alignment> const &) {
+    return false;
+}
+
+#endif //SWARMING_PROJECT_ALIGNEDALLOCATOR_H
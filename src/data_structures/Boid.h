@@ -3,6 +3,10 @@
 
 #include "definitions/types.h"
 #include "definitions/constants.h"
+#include "definitions/mpi_types.h"
+#include "data_structures/BoidArrays.h"
+#include "algorithms/flocking_kernels.h"
+#include "data_structures/IndexView.h"
 #include <string>
 #include <ostream>
 #include <cmath>
@@ -50,9 +54,11 @@ public:
 
     /**
      * Computes the force of alignment applied on the boid, then updates the boid's force parameter.
+     * @tparam Neighbours range of Boid<Dimension>, e.g. std::vector<Boid<Dimension>> or IndexView<Boid<Dimension>>.
      * @param neighbours list of the boids that are close enough to the agent to apply the force.
      */
-    void alignment_update(const std::vector<Boid<Dimension>> & neighbours) {
+    template <typename Neighbours>
+    void alignment_update(const Neighbours & neighbours) {
         Force<Dimension> alignement(0.0);
         const auto multiplier = ALIGNMENT_NORMALISER / neighbours.size();
         for(const Boid<Dimension> & neighbour : neighbours) {
@@ -63,9 +69,11 @@ public:
 
     /**
      * Computes the force of cohesion applied on the boid, then updates the boid's force parameter.
+     * @tparam Neighbours range of Boid<Dimension>, e.g. std::vector<Boid<Dimension>> or IndexView<Boid<Dimension>>.
      * @param neighbours list of the boids that are close enough to the agent to apply the force.
      */
-    void cohesion_update(const std::vector<Boid<Dimension>> & neighbours) {
+    template <typename Neighbours>
+    void cohesion_update(const Neighbours & neighbours) {
         if(! neighbours.empty()) {
             Position<Dimension> center = compute_center_of_mass(neighbours);
             Distance<Dimension> direction = center - m_position;
@@ -76,15 +84,17 @@ public:
 
     /**
      * Computes the force of separation applied on the boid, then updates the boid's force parameter.
+     * @tparam Neighbours range of Boid<Dimension>, e.g. std::vector<Boid<Dimension>> or IndexView<Boid<Dimension>>.
      * @param neighbours list of the boids that are close enough to the agent to apply the force.
      * @todo For the moment the force is linear. We probably want to change it to inverse of the distance between the
      * two boids.
      */
-    void separation_update(const std::vector<Boid<Dimension>> & neighbours) {
+    template <typename Neighbours>
+    void separation_update(const Neighbours & neighbours) {
         Force<Dimension> separation(0.0);
         for(const Boid<Dimension> & neighbour : neighbours) {
             const Distance<Dimension> to_neighbour = neighbour.m_position - m_position;
-            if(to_neighbour.norm() < REPULSION_DISTANCE) {
+            if(to_neighbour.squared_norm() < REPULSION_DISTANCE * REPULSION_DISTANCE) {
                 separation -= SEPARATION_NORMALISER * to_neighbour;
             }
         }
@@ -121,9 +131,11 @@ public:
 
     /**
      * Computes the center of mass of a number of boids
+     * @tparam Neighbours range of Boid<Dimension>, e.g. std::vector<Boid<Dimension>> or IndexView<Boid<Dimension>>.
      * @param neighbours list of the boids whose center is to be computed
      */
-    Position<Dimension> compute_center_of_mass(const std::vector<Boid<Dimension>> & neighbours) {
+    template <typename Neighbours>
+    Position<Dimension> compute_center_of_mass(const Neighbours & neighbours) {
         Position<Dimension> center(0.0);
         for(const Boid<Dimension> & neighbour : neighbours) {
             center += neighbour.m_position;
@@ -133,30 +145,64 @@ public:
 
     /**
      * Updates all forces at once
+     *
+     * The forces of cohesion, separation and alignment are accumulated in a single pass over the neighbours, so each
+     * neighbour is loaded only once. The result is equal to the one of cohesion_update, separation_update,
+     * border_force_update and alignment_update called in sequence, up to floating-point rounding.
+     * @tparam Neighbours range of Boid<Dimension>, e.g. std::vector<Boid<Dimension>> or IndexView<Boid<Dimension>>.
      * @param neighbours  list of the boids who influence the current agent
-     * @param bottom_left bottom-left corner of the space we want to simulate.
-     * @param top_right   top-right corner of the space we want to simulate.
      */
-    void update_forces(const std::vector<Boid> & neighbours) {
-        for (int j=0; j<Dimension; j++) {
-            m_force[j] = 0.0;
+    template <typename Neighbours>
+    void update_forces(const Neighbours & neighbours) {
+        Position<Dimension> position_sum(0.0);
+        Velocity<Dimension> velocity_sum(0.0);
+        Distance<Dimension> close_neighbours_sum(0.0);
+        for(const Boid<Dimension> & neighbour : neighbours) {
+            Distance<Dimension> to_neighbour;
+            DistanceType squared_distance{0.0};
+            for(std::size_t j{0}; j < Dimension; ++j) {
+                to_neighbour[j]   = neighbour.m_position[j] - m_position[j];
+                squared_distance += to_neighbour[j] * to_neighbour[j];
+                position_sum[j]  += neighbour.m_position[j];
+                velocity_sum[j]  += neighbour.m_velocity[j];
+            }
+            if(squared_distance < REPULSION_DISTANCE * REPULSION_DISTANCE) {
+                close_neighbours_sum += to_neighbour;
+            }
+        }
+
+        std::size_t const number_of_neighbours{neighbours.size()};
+        for(std::size_t j{0}; j < Dimension; ++j) {
+            m_force[j] = -SEPARATION_NORMALISER * close_neighbours_sum[j];
+            if(number_of_neighbours > 0) {
+                m_force[j] += COHESION_NORMALISER * (position_sum[j] / number_of_neighbours - m_position[j]);
+            }
         }
-        cohesion_update(neighbours);
-        separation_update(neighbours);
         border_force_update();
-        alignment_update(neighbours);
+        if(number_of_neighbours > 0) {
+            m_force += (ALIGNMENT_NORMALISER / number_of_neighbours) * velocity_sum;
+        }
+    }
+
+    /**
+     * Updates all forces at once with the vectorised kernels.
+     * @param neighbours positions and velocities of the boids who influence the current agent, stored as
+     *                   contiguous arrays.
+     */
+    void update_forces(const BoidArrays<Dimension> & neighbours) {
+        m_force = neighbours_force_kernel(m_position, neighbours);
+        border_force_update();
     }
 
     /**
      * updates velocity from forces
-     * @param neighbours list of the boids who influence the current agent
      */
-    void update_velocity(const std::vector<Boid> & neighbours) {
+    void update_velocity() {
         m_velocity += TIMESTEP * m_force;
-        const auto velocity_norm = m_velocity.norm();
+        const auto squared_velocity_norm = m_velocity.squared_norm();
 
-        if (velocity_norm > MAX_SPEED) {
-            m_velocity *= MAX_SPEED / velocity_norm;
+        if (squared_velocity_norm > MAX_SPEED * MAX_SPEED) {
+            m_velocity *= MAX_SPEED / std::sqrt(squared_velocity_norm);
         }
     }
 
@@ -185,12 +231,19 @@ public:
      * @param boid a boid.
      * @return     true if the given boid is visible by the current instance, false otherwise.
      */
-    bool is_visible(const Boid<Dimension> & boid) {
-        DistanceType const squared_distance{ this->squared_euclidian_distance(boid) };
-        if (squared_distance <= VISION_DISTANCE*VISION_DISTANCE) {
-            return compute_angle(boid) < VISION_ANGLE;
+    bool is_visible(const Boid<Dimension> & boid) const {
+        DistanceType squared_distance{0.0};
+        VelocityType dot_product{0.0}, squared_speed{0.0};
+        for(std::size_t i{0}; i < Dimension; ++i) {
+            const PositionType to_other{boid.m_position[i] - m_position[i]};
+            squared_distance += to_other * to_other;
+            dot_product      += m_velocity[i] * to_other;
+            squared_speed    += m_velocity[i] * m_velocity[i];
+        }
+        if (squared_distance > VISION_DISTANCE*VISION_DISTANCE) {
+            return false;
         }
-        return false;
+        return is_in_vision_cone(dot_product, squared_speed * squared_distance);
     }
 
     /**
@@ -202,8 +255,8 @@ public:
     float scalar_product(const Boid<Dimension> & boid) {
         const Distance<Dimension> current_to_other = boid.m_position - m_position;
         const Distance<Dimension> piecewise_product = m_velocity * current_to_other;
-        const auto norm_self = m_velocity.norm();
-        const auto norm_other = current_to_other.norm();
+        const auto norm_self = m_velocity.norm2();
+        const auto norm_other = current_to_other.norm2();
         float scalar_product{0.0};
         for (std::size_t j{0}; j < Dimension; ++j) {
             scalar_product += piecewise_product[j];
@@ -264,4 +317,19 @@ bool operator!=(const Boid<Dimension> & lhs, const Boid<Dimension> & rhs) {
     return true;
 };
 
+/**
+ * The boids are sent member by member, as floating-point arrays.
+ */
+template <std::size_t Dimension>
+struct MPIDatatype< Boid<Dimension> > {
+    static constexpr bool predefined{false};
+
+    static MPI_Datatype create() {
+        Boid<Dimension> const boid(Position<Dimension>(0), Velocity<Dimension>(0), Force<Dimension>(0));
+        return create_struct_datatype(boid, {&boid.m_position, &boid.m_velocity, &boid.m_force}, {1, 1, 1},
+                                      {mpi_datatype< Position<Dimension> >(), mpi_datatype< Velocity<Dimension> >(),
+                                       mpi_datatype< Force<Dimension> >()});
+    }
+};
+
 #endif //SWARMING_PROJECT_BOIDS_H
@@ -0,0 +1,112 @@
+#ifndef SWARMING_PROJECT_BOIDARRAYS_H
+#define SWARMING_PROJECT_BOIDARRAYS_H
+
+#include <array>
+#include <vector>
+#include <type_traits>
+
+#include "definitions/types.h"
+#include "data_structures/AlignedAllocator.h"
+
+using types::Position;
+using types::Velocity;
+using types::PositionType;
+using types::VelocityType;
+
+/**
+ * Alignment (in bytes) of the arrays of BoidArrays. 64 bytes is the size of an AVX-512 register and of a cache line.
+ */
+constexpr const std::size_t SIMD_ALIGNMENT{64};
+
+/**
+ * Structure-of-arrays storage of the positions and velocities of a set of boids.
+ *
+ * The coordinate d of the positions (resp. velocities) of all the boids are stored contiguously in m_positions[d]
+ * (resp. m_velocities[d]), so the vectorised kernels can load several boids per instruction.
+ *
+ * @tparam Dimension dimension of the simulated space.
+ */
+template <std::size_t Dimension>
+class BoidArrays {
+
+    static_assert(std::is_same<PositionType, float>::value && std::is_same<VelocityType, float>::value,
+                  "BoidArrays and the vectorised kernels assume single-precision positions and velocities.");
+
+public:
+
+    using Column = std::vector<float, AlignedAllocator<float, SIMD_ALIGNMENT> >;
+
+    std::array<Column, Dimension> m_positions;
+    std::array<Column, Dimension> m_velocities;
+
+    /**
+     * @return the number of boids stored.
+     */
+    std::size_t size() const {
+        return m_positions[0].size();
+    }
+
+    /**
+     * @return true if no boid is stored, false otherwise.
+     */
+    bool empty() const {
+        return m_positions[0].empty();
+    }
+
+    /**
+     * Remove all the boids without releasing the allocated memory.
+     */
+    void clear() {
+        for(std::size_t d{0}; d < Dimension; ++d) {
+            m_positions[d].clear();
+            m_velocities[d].clear();
+        }
+    }
+
+    /**
+     * Copy the positions and velocities of the given boids.
+     * @tparam BoidContainer random-access container of objects with m_position and m_velocity members.
+     * @param boids the boids to copy.
+     */
+    template <typename BoidContainer>
+    void assign(BoidContainer const & boids) {
+        std::size_t const number_of_boids{boids.size()};
+        for(std::size_t d{0}; d < Dimension; ++d) {
+            m_positions[d].resize(number_of_boids);
+            m_velocities[d].resize(number_of_boids);
+        }
+        #pragma omp parallel for
+        for(std::size_t i = 0; i < number_of_boids; ++i) {
+            for(std::size_t d{0}; d < Dimension; ++d) {
+                m_positions[d][i]  = boids[i].m_position[d];
+                m_velocities[d][i] = boids[i].m_velocity[d];
+            }
+        }
+    }
+
+    /**
+     * Append the boid n°index of @a source.
+     * @param source the arrays containing the boid to append.
+     * @param index  index of the boid to append in @a source.
+     */
+    void push_back(BoidArrays<Dimension> const & source, std::size_t index) {
+        for(std::size_t d{0}; d < Dimension; ++d) {
+            m_positions[d].push_back(source.m_positions[d][index]);
+            m_velocities[d].push_back(source.m_velocities[d][index]);
+        }
+    }
+
+    /**
+     * Append a boid.
+     * @param position position of the boid to append.
+     * @param velocity velocity of the boid to append.
+     */
+    void push_back(Position<Dimension> const & position, Velocity<Dimension> const & velocity) {
+        for(std::size_t d{0}; d < Dimension; ++d) {
+            m_positions[d].push_back(position[d]);
+            m_velocities[d].push_back(velocity[d]);
+        }
+    }
+};
+
+#endif //SWARMING_PROJECT_BOIDARRAYS_H
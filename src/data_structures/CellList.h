@@ -0,0 +1,180 @@
+#ifndef SWARMING_PROJECT_CELLLIST_H
+#define SWARMING_PROJECT_CELLLIST_H
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+#include "definitions/types.h"
+#include "definitions/constants.h"
+#include "data_structures/Boid.h"
+
+using types::Position;
+
+/**
+ * Compute 3^exponent at compile-time.
+ * @param exponent the power of 3 we want.
+ * @return 3^exponent.
+ */
+constexpr std::size_t power_of_three(std::size_t exponent) {
+    return (exponent == 0) ? 1 : 3 * power_of_three(exponent - 1);
+}
+
+/**
+ * Uniform grid of cells (cell-list) used to find the neighbours of a boid without scanning all the boids.
+ *
+ * The simulated space [0, GRID_SIZE]^Dimension is divided in cells whose side is at least VISION_DISTANCE, so
+ * every boid visible from a given boid lies either in the same cell or in one of the 3^Dimension - 1 adjacent
+ * cells. The boids are sorted by cell with a counting sort each time the cell-list is rebuilt.
+ *
+ * Boids that are outside of the simulated space are stored in the closest cell on the border. Clamping the cell
+ * coordinates does not break the property above because two boids in adjacent cells stay in adjacent (or equal)
+ * cells after the clamping.
+ *
+ * @tparam Dimension dimension of the simulated space.
+ */
+template <std::size_t Dimension>
+class CellList {
+
+public:
+
+    /**
+     * Construct an empty cell-list covering [0, GRID_SIZE]^Dimension.
+     */
+    CellList()
+            : m_cell_size{VISION_DISTANCE * CELL_SIZE_MARGIN},
+              m_cells_per_side{std::max<std::size_t>(1, static_cast<std::size_t>(std::ceil(GRID_SIZE / m_cell_size)))},
+              m_cell_starts(),
+              m_sorted_indices(),
+              m_boid_cells(),
+              m_scatter_positions()
+    {
+        std::size_t number_of_cells{1};
+        for(std::size_t d{0}; d < Dimension; ++d)
+            number_of_cells *= m_cells_per_side;
+        m_cell_starts.resize(number_of_cells + 1);
+    }
+
+    /**
+     * Sort the given boids by cell.
+     *
+     * This method should be called each time the boids moved and before any call to for_each_candidate.
+     * The allocated memory is kept from one call to another, so rebuilding the cell-list for a constant number
+     * of boids does not allocate.
+     *
+     * @param boids the boids to sort in the cells.
+     */
+    void rebuild(std::vector< Boid<Dimension> > const & boids) {
+        std::size_t const number_of_boids{boids.size()};
+        m_boid_cells.resize(number_of_boids);
+        m_sorted_indices.resize(number_of_boids);
+
+        #pragma omp parallel for
+        for(std::size_t i = 0; i < number_of_boids; ++i) {
+            m_boid_cells[i] = cell_index(boids[i].m_position);
+        }
+
+        // Counting sort: count the number of boids in each cell...
+        std::fill(m_cell_starts.begin(), m_cell_starts.end(), 0);
+        for(std::size_t i{0}; i < number_of_boids; ++i)
+            ++m_cell_starts[m_boid_cells[i] + 1];
+        // ... compute the index of the first boid of each cell...
+        for(std::size_t cell{1}; cell < m_cell_starts.size(); ++cell)
+            m_cell_starts[cell] += m_cell_starts[cell - 1];
+        // ... and place the boids. The sort is stable, so the boids of a given cell are in increasing index order.
+        std::vector<std::size_t> & next_free_position = m_scatter_positions;
+        next_free_position.assign(m_cell_starts.begin(), std::prev(m_cell_starts.end()));
+        for(std::size_t i{0}; i < number_of_boids; ++i)
+            m_sorted_indices[next_free_position[m_boid_cells[i]]++] = i;
+    }
+
+    /**
+     * Call @a function on the index of each boid stored in the cell of @a position or in one of the adjacent cells.
+     *
+     * Every boid within VISION_DISTANCE of @a position is guaranteed to be visited. Each boid is visited at most
+     * once.
+     *
+     * @tparam Function callable with a signature compatible with void(std::size_t).
+     * @param position the position around which we search the boids.
+     * @param function the function to call on each candidate boid index.
+     */
+    template <typename Function>
+    void for_each_candidate(Position<Dimension> const & position, Function && function) const {
+        std::size_t coordinates[Dimension];
+        for(std::size_t d{0}; d < Dimension; ++d)
+            coordinates[d] = cell_coordinate(position[d]);
+
+        for(std::size_t offset{0}; offset < power_of_three(Dimension); ++offset) {
+            // Decode the offset as a vector of {-1, 0, 1}^Dimension and compute the corresponding cell.
+            std::size_t cell{0}, stride{1}, remaining_offset{offset};
+            bool is_inside{true};
+            for(std::size_t d{0}; d < Dimension && is_inside; ++d) {
+                std::size_t const neighbour_coordinate{coordinates[d] + remaining_offset % 3};
+                remaining_offset /= 3;
+                // neighbour_coordinate is shifted by +1, so 0 and m_cells_per_side+1 are outside of the grid.
+                if(neighbour_coordinate == 0 || neighbour_coordinate > m_cells_per_side) {
+                    is_inside = false;
+                }
+                cell   += (neighbour_coordinate - 1) * stride;
+                stride *= m_cells_per_side;
+            }
+            if(!is_inside)
+                continue;
+
+            for(std::size_t k{m_cell_starts[cell]}; k < m_cell_starts[cell + 1]; ++k)
+                function(m_sorted_indices[k]);
+        }
+    }
+
+    /**
+     * Compute the index of the cell containing the given position.
+     * @param position a position, possibly outside of the simulated space.
+     * @return the index of the cell containing @a position.
+     */
+    std::size_t cell_index(Position<Dimension> const & position) const {
+        std::size_t cell{0}, stride{1};
+        for(std::size_t d{0}; d < Dimension; ++d) {
+            cell   += cell_coordinate(position[d]) * stride;
+            stride *= m_cells_per_side;
+        }
+        return cell;
+    }
+
+private:
+
+    /**
+     * Compute the (clamped) coordinate of the cell containing the given coordinate along one axis.
+     * @param coordinate coordinate of a point along one axis.
+     * @return the coordinate of the cell along the same axis, in [0, m_cells_per_side-1].
+     */
+    std::size_t cell_coordinate(PositionType coordinate) const {
+        float const cell{std::floor(coordinate / m_cell_size)};
+        if(!(cell > 0.0f))
+            return 0;
+        return std::min(static_cast<std::size_t>(cell), m_cells_per_side - 1);
+    }
+
+    /**
+     * The cells are slightly bigger than VISION_DISTANCE so that rounding errors when computing the cell of a
+     * position can not put two visible boids in non-adjacent cells. The last cells may go beyond GRID_SIZE.
+     */
+    static constexpr float CELL_SIZE_MARGIN{1.0f + 1e-5f};
+
+    float       m_cell_size;
+    std::size_t m_cells_per_side;
+
+    /**
+     * m_sorted_indices[m_cell_starts[c]] to m_sorted_indices[m_cell_starts[c+1]-1] are the indices of the boids
+     * in the cell c.
+     */
+    std::vector<std::size_t> m_cell_starts;
+    std::vector<std::size_t> m_sorted_indices;
+    /**
+     * Buffers used during the rebuild, kept to avoid re-allocations.
+     */
+    std::vector<std::size_t> m_boid_cells;
+    std::vector<std::size_t> m_scatter_positions;
+};
+
+#endif //SWARMING_PROJECT_CELLLIST_H
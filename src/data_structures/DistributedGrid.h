@@ -0,0 +1,594 @@
+#ifndef SWARMING_PROJECT_DISTRIBUTEDGRID_H
+#define SWARMING_PROJECT_DISTRIBUTEDGRID_H
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+#include "mpi.h"
+
+#include "definitions/types.h"
+#include "definitions/constants.h"
+#include "definitions/mpi_types.h"
+#include "data_structures/Boid.h"
+#include "data_structures/Octree.h"
+#include "data_structures/Grid.h"
+
+using types::Position;
+
+/**
+ * Distributed-memory version of Grid: the boids are shared between the MPI processes of MPI_COMM_WORLD.
+ *
+ * The simulated space is cut in 2^(Dimension*BLOCK_DEPTH) blocks, the octants of depth BLOCK_DEPTH. Each process
+ * owns a contiguous range of blocks in Morton order, chosen so that all the processes own approximately the same
+ * number of boids, and stores the boids located in its blocks in a local Grid. After each step, the boids that
+ * left the blocks of their process are migrated to their new owner.
+ *
+ * The boids close to the blocks of other processes need neighbours owned by these processes: before each step, the
+ * position and velocity of these boundary boids are sent as ghosts to the processes whose blocks are within
+ * VISION_DISTANCE of their block. The exchange is overlapped with the update of the interior boids, whose
+ * neighbours are all local.
+ *
+ * The cost of each block is measured at each step as the number of boids plus the number of neighbour pairs found.
+ * When the most loaded process exceeds the mean cost by more than m_imbalance_threshold, the boundaries between
+ * consecutive processes are moved to balance the costs, only exchanging blocks between neighbouring processes.
+ *
+ * @tparam Distribution The probability distribution used to create the boids inside the space.
+ * @tparam Dimension    The dimension of the space.
+ */
+template <typename Distribution, std::size_t Dimension>
+class DistributedGrid {
+
+public:
+
+    /**
+     * Depth of the octants used as blocks for the partition. Deep enough to balance the boids between a few
+     * thousands of processes, small enough to keep the histogram of the blocks cheap to reduce.
+     */
+    static constexpr std::size_t BLOCK_DEPTH{Dimension <= 2 ? 8 : 5};
+    static_assert(BLOCK_DEPTH <= constants::Dmax, "The blocks cannot be deeper than the leaf octants.");
+
+    /**
+     * Number of blocks the simulated space is cut in.
+     */
+    static constexpr std::size_t NUMBER_OF_BLOCKS{std::size_t{1} << (Dimension * BLOCK_DEPTH)};
+
+    /**
+     * Constructor for the DistributedGrid class. Should be called by all the processes of MPI_COMM_WORLD.
+     *
+     * The boids generated are the same as the ones of a Grid with the same parameters, whatever the number of
+     * processes.
+     * @param global_number_of_boids The number of randomly-distributed boids initially in the grid, summed over
+     *                               all the processes.
+     * @param neighbour_search       The strategy used to find the neighbours of a boid.
+     * @param force_kernel           The implementation used to compute the forces applied on the boids.
+     * @param seed                   The seed used to generate the boids.
+     */
+    explicit DistributedGrid(std::size_t global_number_of_boids,
+                             NeighbourSearch neighbour_search = NeighbourSearch::NAIVE,
+                             ForceKernel force_kernel = ForceKernel::SCALAR,
+                             std::uint64_t seed = DEFAULT_SEED)
+            : m_grid(0, neighbour_search, force_kernel, seed)
+    {
+        MPI_Comm_size(MPI_COMM_WORLD, &m_process_number);
+        MPI_Comm_rank(MPI_COMM_WORLD, &m_process_ID);
+        m_boid_type = mpi_datatype< Boid<Dimension> >();
+
+        // Each process generates a slice of the global population, then the boids are sent to their owner.
+        std::size_t const first_index{global_number_of_boids * m_process_ID / m_process_number};
+        std::size_t const last_index{global_number_of_boids * (m_process_ID + 1) / m_process_number};
+        m_grid.add_boids(last_index - first_index, first_index);
+        repartition();
+    }
+
+    DistributedGrid(DistributedGrid const &) = delete;
+    DistributedGrid & operator=(DistributedGrid const &) = delete;
+
+    /**
+     * Computes forces, velocity and then position for all the local boids, then migrates the boids that left the
+     * blocks of this process. Should be called by all the processes.
+     *
+     * The ghosts are received while the interior boids are updated. The boundary boids are updated afterwards,
+     * with the ghosts appended to the local boids as additional neighbours, so the search structure is built
+     * twice per step.
+     */
+    void update_all_boids() {
+        std::size_t const number_of_local_boids{m_grid.m_boids.size()};
+
+        double start{MPI_Wtime()};
+        start_ghost_exchange();
+        m_ghost_exchange_time += MPI_Wtime() - start;
+
+        m_grid.prepare_update();
+        m_grid.update_boids(m_interior_boids);
+
+        start = MPI_Wtime();
+        finish_ghost_exchange();
+        m_ghost_exchange_time += MPI_Wtime() - start;
+
+        m_grid.prepare_update();
+        m_grid.update_boids(m_boundary_boids);
+        m_grid.finish_update(number_of_local_boids);
+
+        start = MPI_Wtime();
+        rebalance_if_needed();
+        migrate_boids();
+        m_migration_time += MPI_Wtime() - start;
+    }
+
+    /**
+     * Compute a new partition of the blocks balancing the number of boids of each process, and migrate the boids
+     * accordingly. Should be called by all the processes.
+     */
+    void repartition() {
+        // Global number of boids in each block.
+        std::vector<unsigned long long> boids_per_block(NUMBER_OF_BLOCKS, 0);
+        for(auto const & boid : m_grid.m_boids)
+            ++boids_per_block[block_index(boid.m_position)];
+        MPI_Allreduce(MPI_IN_PLACE, boids_per_block.data(), static_cast<int>(NUMBER_OF_BLOCKS),
+                      MPI_UNSIGNED_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+
+        // prefix[b] is the number of boids in the blocks before the block b.
+        std::vector<unsigned long long> prefix(NUMBER_OF_BLOCKS + 1, 0);
+        for(std::size_t block{0}; block < NUMBER_OF_BLOCKS; ++block)
+            prefix[block + 1] = prefix[block] + boids_per_block[block];
+
+        // The process p starts at the block boundary closest to p/process_number of the boids.
+        std::size_t const process_number{static_cast<std::size_t>(m_process_number)};
+        m_first_blocks.assign(process_number + 1, NUMBER_OF_BLOCKS);
+        m_first_blocks[0] = 0;
+        for(std::size_t p{1}; p < process_number; ++p) {
+            unsigned long long const target{prefix.back() * p / process_number};
+            m_first_blocks[p] = std::max(closest_boundary(prefix, target), m_first_blocks[p - 1]);
+        }
+
+        compute_ghost_processes();
+        migrate_boids();
+    }
+
+    /**
+     * Compute the global number of boids. Should be called by all the processes.
+     * @return the number of boids summed over all the processes.
+     */
+    std::size_t global_number_of_boids() const {
+        unsigned long long local_number{m_grid.m_boids.size()}, global_number{0};
+        MPI_Allreduce(&local_number, &global_number, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+        return static_cast<std::size_t>(global_number);
+    }
+
+    /**
+     * Compute the block containing a position.
+     * @param position a position, possibly outside of the simulated space.
+     * @return the index of the block containing @a position, in Morton order.
+     */
+    static std::size_t block_index(Position<Dimension> const & position) {
+        // The 5 lowest bits of a Morton index store the depth of the octant (see get_morton_index), the following
+        // bits interleave the coordinates from the least significant bit.
+        return static_cast<std::size_t>(leaf_octant<Dimension>(position).morton_index()
+                                        >> (5 + Dimension * (constants::Dmax - BLOCK_DEPTH)));
+    }
+
+    /**
+     * Compute the process owning a block.
+     * @param block index of the block.
+     * @return the rank of the process owning @a block.
+     */
+    int owner(std::size_t block) const {
+        return static_cast<int>(std::upper_bound(m_first_blocks.begin(), m_first_blocks.end(), block)
+                                - m_first_blocks.begin()) - 1;
+    }
+
+    /**
+     * Compute the octant of depth BLOCK_DEPTH corresponding to a block.
+     * @param block index of the block.
+     * @return the octant covering the block.
+     */
+    static Octree<Dimension> block_octant(std::size_t block) {
+        Coordinate<Dimension> anchor;
+        for(std::size_t d{0}; d < Dimension; ++d) {
+            CoordinateType coordinate{0};
+            for(std::size_t bit{0}; bit < BLOCK_DEPTH; ++bit)
+                coordinate |= static_cast<CoordinateType>((block >> (bit * Dimension + d)) & 1) << bit;
+            anchor[d] = coordinate << (constants::Dmax - BLOCK_DEPTH);
+        }
+        return Octree<Dimension>(anchor, BLOCK_DEPTH);
+    }
+
+    /**
+     * The boids owned by this process.
+     */
+    Grid<Distribution, Dimension> m_grid;
+
+    /**
+     * The process p owns the blocks [m_first_blocks[p], m_first_blocks[p+1]).
+     */
+    std::vector<std::size_t> m_first_blocks;
+
+    /**
+     * Time spent (in seconds) rebalancing and migrating the boids in update_all_boids since the creation of the
+     * grid.
+     */
+    double m_migration_time{0.0};
+
+    /**
+     * Time spent (in seconds) packing the ghosts and waiting for the ghosts of the other processes in
+     * update_all_boids since the creation of the grid.
+     */
+    double m_ghost_exchange_time{0.0};
+
+    /**
+     * The blocks are rebalanced after a step when the cost of the most loaded process is greater than
+     * m_imbalance_threshold times the mean cost. Should be the same on all the processes, an infinite value
+     * disables the rebalancing.
+     */
+    double m_imbalance_threshold{1.1};
+
+    /**
+     * Number of rebalancings since the creation of the grid.
+     */
+    std::size_t m_rebalance_count{0};
+
+private:
+
+    /**
+     * Find the block boundary closest to a target cost.
+     * @param prefix prefix[b] is the cost of the b first blocks of a range, non-decreasing.
+     * @param target the target cost.
+     * @return the index b minimising |prefix[b] - target|.
+     */
+    static std::size_t closest_boundary(std::vector<unsigned long long> const & prefix, unsigned long long target) {
+        std::size_t boundary{static_cast<std::size_t>(
+                std::lower_bound(prefix.begin(), prefix.end(), target) - prefix.begin())};
+        if(boundary == prefix.size())
+            return prefix.size() - 1;
+        if(boundary > 0 && target - prefix[boundary - 1] < prefix[boundary] - target)
+            --boundary;
+        return boundary;
+    }
+
+    /**
+     * Measure the cost of the local blocks at the last step and, if the processes are too imbalanced, move the
+     * boundaries between consecutive processes towards a balanced partition. Should be called by all the
+     * processes, after a step and before migrating the boids.
+     *
+     * The boundary between the processes p-1 and p targets the cost (p/process_number) * total cost. Only the
+     * process giving blocks knows their cost, so it computes the new boundary, inside its own range: the blocks
+     * only move between neighbouring processes, and a strong imbalance may need several steps to be resolved.
+     */
+    void rebalance_if_needed() {
+        std::vector< Boid<Dimension> > const & boids = m_grid.m_boids;
+        std::size_t const first_block{m_first_blocks[m_process_ID]};
+        std::size_t const last_block{m_first_blocks[m_process_ID + 1]};
+        std::size_t const process_number{static_cast<std::size_t>(m_process_number)};
+
+        // A boid that left the blocks of this process will be measured by its new owner at the next step.
+        m_block_costs.assign(last_block - first_block + 1, 0);
+        for(std::size_t i{0}; i < boids.size(); ++i) {
+            std::size_t const block{block_index(boids[i].m_position)};
+            if(first_block <= block && block < last_block)
+                m_block_costs[block - first_block + 1] += 1 + m_grid.m_neighbour_counts[i];
+        }
+        // m_block_costs[b] becomes the cost of the b first local blocks.
+        for(std::size_t b{1}; b < m_block_costs.size(); ++b)
+            m_block_costs[b] += m_block_costs[b - 1];
+
+        std::vector<unsigned long long> process_costs(process_number, 0);
+        MPI_Allgather(&m_block_costs.back(), 1, MPI_UNSIGNED_LONG_LONG, process_costs.data(), 1,
+                      MPI_UNSIGNED_LONG_LONG, MPI_COMM_WORLD);
+        std::vector<unsigned long long> prefix(process_number + 1, 0);
+        for(std::size_t p{0}; p < process_number; ++p)
+            prefix[p + 1] = prefix[p] + process_costs[p];
+        unsigned long long const maximum_cost{*std::max_element(process_costs.begin(), process_costs.end())};
+        if(maximum_cost * process_number <= m_imbalance_threshold * prefix.back())
+            return;
+
+        // Each boundary is moved by the process giving blocks, the others contribute 0 to the sum.
+        std::size_t const p{static_cast<std::size_t>(m_process_ID)};
+        std::vector<long long> shifts(process_number + 1, 0);
+        unsigned long long const left_target{prefix.back() * p / process_number};
+        if(p > 0 && prefix[p] < left_target) {
+            shifts[p] = static_cast<long long>(closest_boundary(m_block_costs, left_target - prefix[p]));
+        }
+        unsigned long long const right_target{prefix.back() * (p + 1) / process_number};
+        if(p + 1 < process_number && prefix[p + 1] > right_target) {
+            std::size_t const boundary{right_target <= prefix[p]
+                                       ? 0 : closest_boundary(m_block_costs, right_target - prefix[p])};
+            shifts[p + 1] = static_cast<long long>(boundary) - static_cast<long long>(last_block - first_block);
+        }
+        MPI_Allreduce(MPI_IN_PLACE, shifts.data(), static_cast<int>(process_number + 1), MPI_LONG_LONG, MPI_SUM,
+                      MPI_COMM_WORLD);
+
+        for(std::size_t q{1}; q < process_number; ++q)
+            m_first_blocks[q] = static_cast<std::size_t>(static_cast<long long>(m_first_blocks[q]) + shifts[q]);
+        compute_ghost_processes();
+        ++m_rebalance_count;
+    }
+
+    /**
+     * Tell whether two octants are closer than VISION_DISTANCE, i.e. whether a boid of one of them may see a boid
+     * of the other one. The octants on the border of the simulated space are considered infinite towards the
+     * outside, because they also store the boids that left the simulated space.
+     * @param a the first octant.
+     * @param b the second octant.
+     * @return true if the distance between @a a and @a b is at most VISION_DISTANCE.
+     */
+    static bool within_vision(Octree<Dimension> const & a, Octree<Dimension> const & b) {
+        CoordinateType const number_of_leaves_per_side{CoordinateType{1} << constants::Dmax};
+        float const leaf_size{static_cast<float>(GRID_SIZE) / static_cast<float>(number_of_leaves_per_side)};
+        float const infinity{std::numeric_limits<float>::infinity()};
+        CoordinateType const a_size{CoordinateType{1} << (constants::Dmax - a.m_depth)};
+        CoordinateType const b_size{CoordinateType{1} << (constants::Dmax - b.m_depth)};
+
+        DistanceType squared_distance{0.0f};
+        for(std::size_t d{0}; d < Dimension; ++d) {
+            float const a_lower{a.m_anchor[d] == 0 ? -infinity : a.m_anchor[d] * leaf_size};
+            float const a_upper{a.m_anchor[d] + a_size >= number_of_leaves_per_side
+                                ? infinity : (a.m_anchor[d] + a_size) * leaf_size};
+            float const b_lower{b.m_anchor[d] == 0 ? -infinity : b.m_anchor[d] * leaf_size};
+            float const b_upper{b.m_anchor[d] + b_size >= number_of_leaves_per_side
+                                ? infinity : (b.m_anchor[d] + b_size) * leaf_size};
+            if(a_upper < b_lower)
+                squared_distance += (b_lower - a_upper) * (b_lower - a_upper);
+            else if(b_upper < a_lower)
+                squared_distance += (a_lower - b_upper) * (a_lower - b_upper);
+        }
+        // Small margin to be robust to the rounding errors on the bounds of the octants.
+        return squared_distance <= VISION_DISTANCE * VISION_DISTANCE * (1.0f + 1e-5f);
+    }
+
+    /**
+     * For each block of this process, find the other processes owning a block within VISION_DISTANCE, i.e. the
+     * processes needing the boids of this block as ghosts. The relation is symmetric, so the processes receiving
+     * ghosts from this process are also the ones sending ghosts to it.
+     *
+     * The blocks are found by a descent in the octree from the root, stopping at the octants too far from the
+     * block or entirely owned by a single process (their blocks form a contiguous range in Morton order).
+     */
+    void compute_ghost_processes() {
+        std::size_t const first_block{m_first_blocks[m_process_ID]};
+        std::size_t const last_block{m_first_blocks[m_process_ID + 1]};
+        std::size_t const block_shift{5 + Dimension * (constants::Dmax - BLOCK_DEPTH)};
+
+        m_ghost_processes.assign(last_block - first_block, std::vector<int>());
+        std::vector<int> is_neighbour(static_cast<std::size_t>(m_process_number), 0);
+
+        for(std::size_t block{first_block}; block < last_block; ++block) {
+            Octree<Dimension> const octant{block_octant(block)};
+            std::vector<int> & processes = m_ghost_processes[block - first_block];
+
+            // Each level of the descent pushes at most 2^Dimension octants on the stack.
+            Octree<Dimension> stack[BLOCK_DEPTH * (1ULL << Dimension) + 1];
+            std::size_t stack_size{0};
+            Coordinate<Dimension> root_anchor;
+            for(std::size_t d{0}; d < Dimension; ++d)
+                root_anchor[d] = 0;
+            stack[stack_size++] = Octree<Dimension>(root_anchor, 0);
+
+            while(stack_size > 0) {
+                Octree<Dimension> const node = stack[--stack_size];
+                if(!within_vision(node, octant))
+                    continue;
+
+                // The blocks covered by node are [node_first, node_last].
+                std::size_t const node_first{static_cast<std::size_t>(
+                        Octree<Dimension>(node.m_anchor, constants::Dmax).morton_index() >> block_shift)};
+                std::size_t const node_last{
+                        node_first + (std::size_t{1} << (Dimension * (BLOCK_DEPTH - node.m_depth))) - 1};
+                int const first_owner{owner(node_first)};
+                if(first_owner == owner(node_last)) {
+                    if(first_owner != m_process_ID)
+                        processes.push_back(first_owner);
+                    continue;
+                }
+
+                CoordinateType const child_size{CoordinateType{1} << (constants::Dmax - node.m_depth - 1)};
+                for(std::size_t child_number{0}; child_number < (1ULL << Dimension); ++child_number) {
+                    Coordinate<Dimension> child_anchor = node.m_anchor;
+                    for(std::size_t d{0}; d < Dimension; ++d)
+                        child_anchor[d] += ((child_number >> d) & 1) * child_size;
+                    stack[stack_size++] = Octree<Dimension>(child_anchor, node.m_depth + 1);
+                }
+            }
+
+            std::sort(processes.begin(), processes.end());
+            processes.erase(std::unique(processes.begin(), processes.end()), processes.end());
+            for(int const process : processes)
+                is_neighbour[process] = 1;
+        }
+
+        m_neighbours.clear();
+        m_neighbour_index.assign(static_cast<std::size_t>(m_process_number), -1);
+        for(int process{0}; process < m_process_number; ++process) {
+            if(is_neighbour[process]) {
+                m_neighbour_index[process] = static_cast<int>(m_neighbours.size());
+                m_neighbours.push_back(process);
+            }
+        }
+    }
+
+    /**
+     * Sort the local boids in interior and boundary boids, send the position and velocity of the boundary boids
+     * to the processes needing them as ghosts and start receiving the ghosts of the other processes.
+     *
+     * The numbers of ghosts are exchanged first (blocking), then the ghosts themselves are exchanged with
+     * non-blocking messages, completed by finish_ghost_exchange.
+     */
+    void start_ghost_exchange() {
+        std::vector< Boid<Dimension> > const & boids = m_grid.m_boids;
+        std::size_t const first_block{m_first_blocks[m_process_ID]};
+        std::size_t const number_of_neighbours{m_neighbours.size()};
+
+        m_interior_boids.clear();
+        m_boundary_boids.clear();
+        m_ghost_send_buffers.resize(number_of_neighbours);
+        for(auto & buffer : m_ghost_send_buffers)
+            buffer.clear();
+
+        // The boids were migrated after the last step: all the local boids are in the blocks of this process.
+        for(std::size_t i{0}; i < boids.size(); ++i) {
+            std::vector<int> const & processes = m_ghost_processes[block_index(boids[i].m_position) - first_block];
+            if(processes.empty()) {
+                m_interior_boids.push_back(i);
+                continue;
+            }
+            m_boundary_boids.push_back(i);
+            for(int const process : processes) {
+                std::vector<float> & buffer = m_ghost_send_buffers[m_neighbour_index[process]];
+                buffer.insert(buffer.end(), boids[i].m_position.begin(), boids[i].m_position.end());
+                buffer.insert(buffer.end(), boids[i].m_velocity.begin(), boids[i].m_velocity.end());
+            }
+        }
+
+        m_ghost_send_counts.resize(number_of_neighbours);
+        m_ghost_receive_counts.assign(number_of_neighbours, 0);
+        m_ghost_requests.clear();
+        for(std::size_t k{0}; k < number_of_neighbours; ++k) {
+            m_ghost_send_counts[k] = static_cast<int>(m_ghost_send_buffers[k].size());
+            m_ghost_requests.emplace_back();
+            MPI_Irecv(&m_ghost_receive_counts[k], 1, MPI_INT, m_neighbours[k], GHOST_COUNT_TAG, MPI_COMM_WORLD,
+                      &m_ghost_requests.back());
+            m_ghost_requests.emplace_back();
+            MPI_Isend(&m_ghost_send_counts[k], 1, MPI_INT, m_neighbours[k], GHOST_COUNT_TAG, MPI_COMM_WORLD,
+                      &m_ghost_requests.back());
+        }
+        MPI_Waitall(static_cast<int>(m_ghost_requests.size()), m_ghost_requests.data(), MPI_STATUSES_IGNORE);
+
+        std::vector<int> receive_displacements(number_of_neighbours + 1, 0);
+        for(std::size_t k{0}; k < number_of_neighbours; ++k)
+            receive_displacements[k + 1] = receive_displacements[k] + m_ghost_receive_counts[k];
+        m_ghost_receive_buffer.resize(static_cast<std::size_t>(receive_displacements.back()));
+
+        m_ghost_requests.clear();
+        for(std::size_t k{0}; k < number_of_neighbours; ++k) {
+            m_ghost_requests.emplace_back();
+            MPI_Irecv(m_ghost_receive_buffer.data() + receive_displacements[k], m_ghost_receive_counts[k], MPI_FLOAT,
+                      m_neighbours[k], GHOST_DATA_TAG, MPI_COMM_WORLD, &m_ghost_requests.back());
+            m_ghost_requests.emplace_back();
+            MPI_Isend(m_ghost_send_buffers[k].data(), m_ghost_send_counts[k], MPI_FLOAT, m_neighbours[k],
+                      GHOST_DATA_TAG, MPI_COMM_WORLD, &m_ghost_requests.back());
+        }
+    }
+
+    /**
+     * Wait for the ghosts of the other processes and append them to the local boids.
+     */
+    void finish_ghost_exchange() {
+        MPI_Waitall(static_cast<int>(m_ghost_requests.size()), m_ghost_requests.data(), MPI_STATUSES_IGNORE);
+
+        std::vector< Boid<Dimension> > & boids = m_grid.m_boids;
+        for(std::size_t offset{0}; offset < m_ghost_receive_buffer.size(); offset += 2 * Dimension) {
+            Position<Dimension> position;
+            Velocity<Dimension> velocity;
+            for(std::size_t d{0}; d < Dimension; ++d) {
+                position[d] = m_ghost_receive_buffer[offset + d];
+                velocity[d] = m_ghost_receive_buffer[offset + Dimension + d];
+            }
+            boids.emplace_back(position, velocity, Force<Dimension>(0.0));
+        }
+    }
+
+    /**
+     * Send the local boids that are not in the blocks of this process to their owner, and receive the boids that
+     * entered the blocks of this process.
+     */
+    void migrate_boids() {
+        std::vector< Boid<Dimension> > & boids = m_grid.m_boids;
+        std::size_t const process_number{static_cast<std::size_t>(m_process_number)};
+
+        m_destinations.resize(boids.size());
+        #pragma omp parallel for
+        for(std::size_t i = 0; i < boids.size(); ++i) {
+            m_destinations[i] = owner(block_index(boids[i].m_position));
+        }
+
+        // Counting sort of the leaving boids by destination. The boids staying on this process are compacted at
+        // the beginning of the local array.
+        std::vector<int> send_counts(process_number, 0), send_displacements(process_number, 0);
+        for(std::size_t i{0}; i < boids.size(); ++i) {
+            if(m_destinations[i] != m_process_ID)
+                ++send_counts[m_destinations[i]];
+        }
+        for(std::size_t p{1}; p < process_number; ++p)
+            send_displacements[p] = send_displacements[p - 1] + send_counts[p - 1];
+
+        m_send_buffer.clear();
+        m_send_buffer.resize(send_displacements.back() + send_counts.back(), Boid<Dimension>(
+                Position<Dimension>(0.0), Velocity<Dimension>(0.0), Force<Dimension>(0.0)));
+        std::vector<int> next_positions(send_displacements);
+        std::size_t number_of_staying_boids{0};
+        for(std::size_t i{0}; i < boids.size(); ++i) {
+            if(m_destinations[i] == m_process_ID)
+                boids[number_of_staying_boids++] = boids[i];
+            else
+                m_send_buffer[next_positions[m_destinations[i]]++] = boids[i];
+        }
+        boids.erase(boids.begin() + number_of_staying_boids, boids.end());
+
+        // Exchange the number of boids, then the boids.
+        std::vector<int> receive_counts(process_number, 0), receive_displacements(process_number, 0);
+        MPI_Alltoall(send_counts.data(), 1, MPI_INT, receive_counts.data(), 1, MPI_INT, MPI_COMM_WORLD);
+        for(std::size_t p{1}; p < process_number; ++p)
+            receive_displacements[p] = receive_displacements[p - 1] + receive_counts[p - 1];
+
+        boids.resize(number_of_staying_boids + receive_displacements.back() + receive_counts.back(), Boid<Dimension>(
+                Position<Dimension>(0.0), Velocity<Dimension>(0.0), Force<Dimension>(0.0)));
+        MPI_Alltoallv(m_send_buffer.data(), send_counts.data(), send_displacements.data(), m_boid_type,
+                      boids.data() + number_of_staying_boids, receive_counts.data(), receive_displacements.data(),
+                      m_boid_type, MPI_COMM_WORLD);
+    }
+
+    static constexpr int GHOST_COUNT_TAG{1};
+    static constexpr int GHOST_DATA_TAG{2};
+
+    int m_process_ID;
+    int m_process_number;
+
+    /**
+     * MPI datatype of a Boid (see mpi_datatype).
+     */
+    MPI_Datatype m_boid_type;
+
+    /**
+     * Buffers of migrate_boids, whose memory is kept between the steps.
+     */
+    std::vector<int>                m_destinations;
+    std::vector< Boid<Dimension> >  m_send_buffer;
+
+    /**
+     * Buffer of rebalance_if_needed: m_block_costs[b] is the cost of the b first blocks of this process.
+     */
+    std::vector<unsigned long long> m_block_costs;
+
+    /**
+     * m_ghost_processes[b] lists the processes needing the boids of the block first_block + b as ghosts, where
+     * first_block is the first block of this process.
+     */
+    std::vector< std::vector<int> > m_ghost_processes;
+    /**
+     * The processes exchanging ghosts with this process, in increasing order, and the position of each process in
+     * m_neighbours (-1 for the other processes).
+     */
+    std::vector<int>                m_neighbours;
+    std::vector<int>                m_neighbour_index;
+
+    /**
+     * Buffers of the ghost exchange, whose memory is kept between the steps. A ghost is sent as its position
+     * followed by its velocity.
+     */
+    std::vector<std::size_t>          m_interior_boids;
+    std::vector<std::size_t>          m_boundary_boids;
+    std::vector< std::vector<float> > m_ghost_send_buffers;
+    std::vector<float>                m_ghost_receive_buffer;
+    std::vector<int>                  m_ghost_send_counts;
+    std::vector<int>                  m_ghost_receive_counts;
+    std::vector<MPI_Request>          m_ghost_requests;
+};
+
+template <typename Distribution, std::size_t Dimension>
+constexpr std::size_t DistributedGrid<Distribution, Dimension>::BLOCK_DEPTH;
+
+template <typename Distribution, std::size_t Dimension>
+constexpr std::size_t DistributedGrid<Distribution, Dimension>::NUMBER_OF_BLOCKS;
+
+#endif //SWARMING_PROJECT_DISTRIBUTEDGRID_H
@@ -4,14 +4,48 @@
 #include "definitions/types.h"
 #include "definitions/constants.h"
 #include "data_structures/Boid.h"
+#include "data_structures/CellList.h"
+#include "data_structures/OctreeNeighbourSearch.h"
+#include "data_structures/BoidArrays.h"
+#include "data_structures/IndexView.h"
+#include "data_structures/Philox.h"
 #include <random>
+#include <cstdint>
 #include <vector>
+#include <utility>
 #include <ostream>
 #include <omp.h>
 
 using types::Position;
 using namespace constants;
 
+/**
+ * Strategies available to find the neighbours of a boid.
+ */
+enum class NeighbourSearch {
+    NAIVE,    /**< Test all the boids of the grid: O(N) per boid. */
+    CELL_LIST, /**< Only test the boids in the adjacent cells of a uniform grid (see CellList). */
+    OCTREE     /**< Only test the boids in the octants close to the boid (see OctreeNeighbourSearch). */
+};
+
+/**
+ * Implementations available to compute the forces applied on the boids.
+ */
+enum class ForceKernel {
+    SCALAR, /**< Use the scalar Boid methods on a view over the neighbours. */
+    SIMD    /**< Pack the neighbours in a BoidArrays and use the vectorised kernels (see flocking_kernels.h). */
+};
+
+/**
+ * Time spent (in seconds) in each phase of Grid::update_all_boids, accumulated over the steps.
+ */
+struct GridTimings {
+    double      search_structure{0.0};    /**< Rebuilding the cell list or the octree. */
+    double      structure_of_arrays{0.0}; /**< Copying the boids in the arrays used by the SIMD kernels. */
+    double      boid_update{0.0};         /**< Finding the neighbours, computing the forces and moving the boids. */
+    std::size_t steps{0};                 /**< Number of steps computed. */
+};
+
 /**
  * Class that represents a physical space.
  * @tparam Distribution The probability distribution used to create the boids inside the space.
@@ -24,9 +58,18 @@ public:
 
     /**
      * Constructor for the Grid class.
-     * @param number_of_boids The number of randomly-distributed boids initially in the grid.
+     * @param number_of_boids  The number of randomly-distributed boids initially in the grid.
+     * @param neighbour_search The strategy used to find the neighbours of a boid.
+     * @param force_kernel     The implementation used to compute the forces applied on the boids.
+     * @param seed             The seed used to generate the boids.
      */
-    explicit Grid(std::size_t number_of_boids = 0)
+    explicit Grid(std::size_t number_of_boids = 0,
+                  NeighbourSearch neighbour_search = NeighbourSearch::NAIVE,
+                  ForceKernel force_kernel = ForceKernel::SCALAR,
+                  std::uint64_t seed = DEFAULT_SEED)
+            : m_neighbour_search(neighbour_search),
+              m_force_kernel(force_kernel),
+              m_seed(seed)
     {
         add_boids(number_of_boids);
     }
@@ -43,27 +86,44 @@ public:
      * @param number_of_boids_to_add The number of boids to add to the grid.
      */
     void add_boids(std::size_t number_of_boids_to_add) {
-        m_boids.reserve(number_of_boids_to_add);
-        std::random_device d;
-        std::default_random_engine generator(d());
-        Distribution distribution_pos(BORDER_SEPARATION_MIN_DISTANCE,
-                                      GRID_SIZE-BORDER_SEPARATION_MIN_DISTANCE);
-        Distribution distribution_vel(-MAX_SPEED,MAX_SPEED);
-        for(std::size_t j{0}; j < number_of_boids_to_add; ++j) {
+        add_boids(number_of_boids_to_add, m_boids.size());
+    }
+
+    /**
+     * Add multiples randmly-distributed boids to the grid, in parallel.
+     *
+     * The boid of global index k is generated from its own random stream, keyed on (seed, k), so the boids
+     * generated only depend on the seed and on their indices: not on the number of threads, nor on the way a
+     * population is split between MPI processes.
+     * @param number_of_boids_to_add The number of boids to add to the grid.
+     * @param first_index            The global index of the first boid added. A process generating the boids
+     *                               [first_index, first_index + number_of_boids_to_add) of a global population
+     *                               gets the same boids as a single process generating the whole population.
+     */
+    void add_boids(std::size_t number_of_boids_to_add, std::size_t first_index) {
+        std::size_t const old_size{m_boids.size()};
+        m_boids.resize(old_size + number_of_boids_to_add,
+                       Boid<Dimension>(Position<Dimension>(0.0), Velocity<Dimension>(0.0), Force<Dimension>(0.0)));
+
+        #pragma omp parallel for
+        for(std::size_t j = 0; j < number_of_boids_to_add; ++j) {
+            Philox4x32 generator(m_seed, first_index + j);
+            Distribution distribution_pos(BORDER_SEPARATION_MIN_DISTANCE,
+                                          GRID_SIZE-BORDER_SEPARATION_MIN_DISTANCE);
+            Distribution distribution_vel(-MAX_SPEED,MAX_SPEED);
             Position<Dimension> pos;
             Velocity<Dimension> vel;
-            Force<Dimension>  force;
 
             for(std::size_t i{0}; i < Dimension; ++i) {
                 pos[i]   = distribution_pos(generator);
                 vel[i]   = distribution_vel(generator);
-                force[i] = 0.0;
             }
-            const double velocity_norm = vel.norm();
+            const auto velocity_norm = vel.norm2();
             if (velocity_norm > MAX_SPEED) {
                 vel *= MAX_SPEED / velocity_norm;
             }
-            this->add_boid(pos, vel, force);
+            m_boids[old_size + j].m_position = pos;
+            m_boids[old_size + j].m_velocity = vel;
         }
     }
 
@@ -76,31 +136,102 @@ public:
         }
     }*/
 
-    std::vector<Boid<Dimension> > get_neighbours_naive(int i) {
-        std::vector<Boid<Dimension> > neighbours;
-        for(std::size_t j = 0; j < m_boids.size(); ++j){
-            if(i != j && m_boids[i].is_visible(m_boids[j])){
-                neighbours.push_back(m_boids[j]);
-            }
-        }
-        return neighbours;
+    /**
+     * Find the neighbours of the i-th boid with the strategy selected for this grid.
+     *
+     * The search structure should have been rebuilt since the last move of the boids. No boid is copied: the
+     * returned view refers to the boids of the grid through the indices stored in @a neighbour_indices, so it is
+     * only valid as long as m_boids and @a neighbour_indices are not modified.
+     * @param i                 index of the boid whose neighbours we want.
+     * @param neighbour_indices buffer receiving the indices of the neighbours. Its memory is re-used, so a buffer
+     *                          kept between the calls avoids any allocation.
+     * @return a view over the boids visible by the i-th boid.
+     */
+    IndexView< Boid<Dimension> > get_neighbours(std::size_t i, std::vector<std::size_t> & neighbour_indices) {
+        neighbour_indices.clear();
+        for_each_neighbour(i, [&neighbour_indices](std::size_t j) {
+            neighbour_indices.push_back(j);
+        });
+        return IndexView< Boid<Dimension> >(m_boids, neighbour_indices);
     }
 
     /**
-     * Computes forces, velocity and then position for all boids and updates them
+     * Computes forces, velocity and then position for all boids and updates them.
+     *
+     * The state of the step n is only read (from m_boids) and the state of the step n+1 is only written (in
+     * m_next_boids), then the two buffers are swapped. The result is therefore deterministic and does not depend
+     * on the order in which the boids are updated.
      */
     void update_all_boids() {
+        prepare_update();
+
+        double const start{omp_get_wtime()};
         #pragma omp parallel for
         for(std::size_t i = 0; i < m_boids.size(); ++i) {
-            std::vector<Boid<Dimension> > neighbours = get_neighbours_naive(i);
-            m_boids[i].update_forces(neighbours);
-            m_boids[i].update_velocity(neighbours);
+            update_boid(i, static_cast<std::size_t>(omp_get_thread_num()));
+        }
+        m_timings.boid_update += omp_get_wtime() - start;
+
+        finish_update(m_boids.size());
+    }
+
+    /**
+     * First phase of a step split by the caller: rebuild the search structure and the arrays of the SIMD kernels
+     * from the current m_boids.
+     *
+     * update_all_boids is equivalent to prepare_update(), update_boids() on all the indices, then
+     * finish_update(m_boids.size()). Splitting the step allows to update the boids in several batches, and to
+     * append to m_boids between two batches some boids that are only used as neighbours (e.g. copies of the boids
+     * of other MPI processes). prepare_update should then be called again: the boids already updated are kept.
+     */
+    void prepare_update() {
+        double const start{omp_get_wtime()};
+        if(m_neighbour_search == NeighbourSearch::CELL_LIST)
+            m_cell_list.rebuild(m_boids);
+        else if(m_neighbour_search == NeighbourSearch::OCTREE)
+            m_octree_search.rebuild(m_boids);
+        double const search_structure_end{omp_get_wtime()};
+
+        // Buffers of each thread, whose memory is kept between the steps.
+        std::size_t const number_of_threads{static_cast<std::size_t>(omp_get_max_threads())};
+        m_neighbour_indices.resize(number_of_threads);
+        if(m_force_kernel == ForceKernel::SIMD) {
+            m_boid_arrays.assign(m_boids);
+            m_neighbour_arrays.resize(number_of_threads);
         }
-        #pragma omp barrier
+        // The updated elements of m_next_boids are overwritten, the value used to resize does not matter.
+        if(m_next_boids.size() != m_boids.size())
+            m_next_boids.resize(m_boids.size(), Boid<Dimension>(Position<Dimension>(0.0), Velocity<Dimension>(0.0),
+                                                                Force<Dimension>(0.0)));
+        m_neighbour_counts.resize(m_boids.size(), 0);
+
+        m_timings.search_structure    += search_structure_end - start;
+        m_timings.structure_of_arrays += omp_get_wtime() - search_structure_end;
+    }
+
+    /**
+     * Compute the next state of some boids, in parallel. prepare_update should have been called since the last
+     * modification of m_boids.
+     * @param indices indices of the boids to update.
+     */
+    void update_boids(std::vector<std::size_t> const & indices) {
+        double const start{omp_get_wtime()};
         #pragma omp parallel for
-        for(std::size_t i = 0; i < m_boids.size(); ++i) {
-            m_boids[i].update_position();
+        for(std::size_t k = 0; k < indices.size(); ++k) {
+            update_boid(indices[k], static_cast<std::size_t>(omp_get_thread_num()));
         }
+        m_timings.boid_update += omp_get_wtime() - start;
+    }
+
+    /**
+     * Last phase of a step split by the caller: the boids updated become the current boids.
+     * @param number_of_boids number of boids kept: all the boids [0, number_of_boids) should have been updated,
+     *                        the following ones (boids only used as neighbours) are removed.
+     */
+    void finish_update(std::size_t number_of_boids) {
+        std::swap(m_boids, m_next_boids);
+        m_boids.erase(m_boids.begin() + number_of_boids, m_boids.end());
+        ++m_timings.steps;
     }
 
     /**
@@ -108,6 +239,122 @@ public:
      */
     std::vector< Boid<Dimension> > m_boids;
 
+    /**
+     * The strategy used to find the neighbours of a boid.
+     */
+    NeighbourSearch m_neighbour_search;
+
+    /**
+     * The implementation used to compute the forces applied on the boids.
+     */
+    ForceKernel m_force_kernel;
+
+    /**
+     * The seed used to generate the boids.
+     */
+    std::uint64_t m_seed;
+
+    /**
+     * Time spent in each phase of update_all_boids since the creation of the grid. Can be reset by the user.
+     */
+    GridTimings m_timings;
+
+    /**
+     * m_neighbour_counts[i] is the number of neighbours found for the i-th boid at its last update, a measure of
+     * the cost of its update. The boids added since the last step have no measure yet.
+     */
+    std::vector<std::size_t> m_neighbour_counts;
+
+private:
+
+    /**
+     * Call @a function on the index of each boid visible by the i-th boid, using the selected search strategy.
+     *
+     * The search structure should have been rebuilt since the last move of the boids.
+     * @tparam Function callable with a signature compatible with void(std::size_t).
+     * @param i        index of the boid whose neighbours we want.
+     * @param function the function to call on each neighbour index.
+     */
+    template <typename Function>
+    void for_each_neighbour(std::size_t i, Function && function) {
+        auto const visit_if_visible = [this, i, &function](std::size_t j) {
+            if(i != j && m_boids[i].is_visible(m_boids[j])) {
+                function(j);
+            }
+        };
+        switch(m_neighbour_search) {
+            case NeighbourSearch::CELL_LIST:
+                m_cell_list.for_each_candidate(m_boids[i].m_position, visit_if_visible);
+                break;
+            case NeighbourSearch::OCTREE:
+                m_octree_search.for_each_candidate(m_boids[i].m_position, visit_if_visible);
+                break;
+            case NeighbourSearch::NAIVE:
+            default:
+                for(std::size_t j{0}; j < m_boids.size(); ++j)
+                    visit_if_visible(j);
+        }
+    }
+
+    /**
+     * Compute the next state of the i-th boid in m_next_boids.
+     * @param i         index of the boid to update.
+     * @param thread_ID index of the calling thread, selecting its buffers.
+     */
+    void update_boid(std::size_t i, std::size_t thread_ID) {
+        Boid<Dimension> & next_boid = m_next_boids[i];
+        next_boid = m_boids[i];
+        if(m_force_kernel == ForceKernel::SIMD) {
+            BoidArrays<Dimension> & neighbours = m_neighbour_arrays[thread_ID];
+            neighbours.clear();
+            if(m_neighbour_search == NeighbourSearch::NAIVE) {
+                // All the boids are candidates: test them by blocks with the vectorised visibility test.
+                std::vector<std::size_t> & visible = m_neighbour_indices[thread_ID];
+                visible.clear();
+                select_visible(m_boids[i].m_position, m_boids[i].m_velocity, m_boid_arrays,
+                               0, m_boids.size(), visible);
+                for(std::size_t const j : visible) {
+                    if(j != i)
+                        neighbours.push_back(m_boid_arrays, j);
+                }
+            }
+            else {
+                for_each_neighbour(i, [this, &neighbours](std::size_t j) {
+                    neighbours.push_back(m_boid_arrays, j);
+                });
+            }
+            next_boid.update_forces(neighbours);
+            m_neighbour_counts[i] = neighbours.size();
+        }
+        else {
+            next_boid.update_forces(get_neighbours(i, m_neighbour_indices[thread_ID]));
+            m_neighbour_counts[i] = m_neighbour_indices[thread_ID].size();
+        }
+        next_boid.update_velocity();
+        next_boid.update_position();
+    }
+
+    /**
+     * The boids at the next step, written by update_boid while m_boids is only read.
+     */
+    std::vector< Boid<Dimension> > m_next_boids;
+
+    CellList<Dimension>              m_cell_list;
+    OctreeNeighbourSearch<Dimension> m_octree_search;
+
+    /**
+     * Structure-of-arrays copy of the boids, refreshed at each step when the SIMD kernels are used.
+     */
+    BoidArrays<Dimension>                m_boid_arrays;
+    /**
+     * One buffer per thread to pack the neighbours of the boid being updated (SIMD kernels).
+     */
+    std::vector< BoidArrays<Dimension> > m_neighbour_arrays;
+    /**
+     * One buffer per thread to store the indices of the neighbours of the boid being updated.
+     */
+    std::vector< std::vector<std::size_t> > m_neighbour_indices;
+
 };
 
 template<typename Dist, std::size_t Dim>
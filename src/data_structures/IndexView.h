@@ -0,0 +1,79 @@
+#ifndef SWARMING_PROJECT_INDEXVIEW_H
+#define SWARMING_PROJECT_INDEXVIEW_H
+
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+/**
+ * Non-owning view over a subset of an array of elements, given by a span of indices.
+ *
+ * Iterating over the view yields references to the elements themselves, so it can be used instead of a container
+ * holding copies of the elements (for example the neighbours of a boid) without copying nor allocating anything.
+ * The view is invalidated if the array of elements or the array of indices is re-allocated.
+ *
+ * @tparam T type of the viewed elements.
+ */
+template <typename T>
+class IndexView {
+
+public:
+
+    /**
+     * Iterator over the elements of an IndexView.
+     */
+    class const_iterator : public std::iterator<std::forward_iterator_tag, T const> {
+    public:
+        const_iterator(T const * elements, std::size_t const * index)
+                : m_elements(elements),
+                  m_index(index)
+        { }
+
+        T const & operator*()  const { return m_elements[*m_index]; }
+        T const * operator->() const { return m_elements + *m_index; }
+
+        const_iterator & operator++() {
+            ++m_index;
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator const copy(*this);
+            ++m_index;
+            return copy;
+        }
+
+        bool operator==(const_iterator const & other) const { return m_index == other.m_index; }
+        bool operator!=(const_iterator const & other) const { return m_index != other.m_index; }
+
+    private:
+        T const *           m_elements;
+        std::size_t const * m_index;
+    };
+
+    /**
+     * Construct a view over elements[indices[0]], ..., elements[indices[indices.size()-1]].
+     * @param elements the viewed elements.
+     * @param indices  indices of the elements in the view.
+     */
+    IndexView(std::vector<T> const & elements, std::vector<std::size_t> const & indices)
+            : m_elements(elements.data()),
+              m_first(indices.data()),
+              m_last(indices.data() + indices.size())
+    { }
+
+    const_iterator begin() const { return const_iterator(m_elements, m_first); }
+    const_iterator end()   const { return const_iterator(m_elements, m_last);  }
+
+    std::size_t size()  const { return static_cast<std::size_t>(m_last - m_first); }
+    bool        empty() const { return m_first == m_last; }
+
+    T const & operator[](std::size_t position) const { return m_elements[m_first[position]]; }
+
+private:
+    T const *           m_elements;
+    std::size_t const * m_first;
+    std::size_t const * m_last;
+};
+
+#endif //SWARMING_PROJECT_INDEXVIEW_H
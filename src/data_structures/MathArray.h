@@ -8,13 +8,61 @@
 #include <initializer_list>
 #include <utility>
 
+namespace math_array_expressions {
+
+    /**
+     * Compile-time unrolled loop: call function(0), ..., function(N-1).
+     *
+     * Used to evaluate the expressions, so the buffers of a few elements are kept in registers even when the
+     * compiler does not unroll loops by itself.
+     * @tparam N number of iterations.
+     */
+    template <std::size_t N>
+    struct Unrolled {
+        template <typename Function>
+        static void for_each(Function & function) {
+            Unrolled<N-1>::for_each(function);
+            function(N-1);
+        }
+    };
+
+    template <>
+    struct Unrolled<0> {
+        template <typename Function>
+        static void for_each(Function &) { }
+    };
+}
+
+/**
+ * Base class of all the array-like operands of the MathArray arithmetic: MathArray itself and the lazy expressions
+ * built by the operators of MathArrayOperators.tpp.
+ *
+ * The arithmetic operators do not compute anything: they return a light object representing the operation, whose
+ * elements are only computed when the expression is assigned to a MathArray. A chain of element-wise operations
+ * is therefore evaluated in a single loop, without any temporary array.
+ * @tparam Derived type of the expression (curiously recurring template pattern).
+ * @tparam S       number of elements of the expression.
+ */
+template <typename Derived, std::size_t S>
+class MathArrayExpression {
+
+public:
+
+    /**
+     * @return the expression as an instance of its real type.
+     */
+    const Derived & derived() const {
+        return static_cast<const Derived &>(*this);
+    }
+};
+
 /**
  * An overload of std::array that implements usefull mathematical operations.
  * @tparam T type of the stored elements.
  * @tparam S number of elements stored.
  */
 template <typename T, std::size_t S>
-class MathArray : public std::array<T, S> {
+class MathArray : public std::array<T, S>, public MathArrayExpression<MathArray<T, S>, S> {
 
     // Ensure that the mathematical operations are well-defined.
     static_assert(std::is_integral<T>::value || std::is_floating_point<T>::value,
@@ -42,12 +90,102 @@ public:
     explicit MathArray(std::array<T, S>   array) : std::array<T, S>(std::forward<std::array<T,S>>(array)) { }
     explicit MathArray(std::array<T, S> & array) : std::array<T, S>(std::forward<std::array<T,S>>(array)) { }
 
+    /**
+     * Construct the array by evaluating an expression, in a single loop.
+     * @tparam E         type of the expression.
+     * @param expression the expression to evaluate.
+     */
+    template <typename E>
+    MathArray(const MathArrayExpression<E, S> & expression) {
+        *this = expression;
+    }
+
+    /**
+     * Evaluate an expression into the array, in a single loop.
+     *
+     * The expression may refer to the array itself. The elements are first evaluated in a local buffer: as the
+     * buffer cannot alias the operands, the compiler is free to keep everything in registers and vectorise.
+     * @tparam E         type of the expression.
+     * @param expression the expression to evaluate.
+     * @return           the updated current instance.
+     */
+    template <typename E>
+    MathArray<T, S> & operator=(const MathArrayExpression<E, S> & expression) {
+        const E & elements = expression.derived();
+        T values[S];
+        auto evaluate = [&values, &elements](std::size_t i) { values[i] = static_cast<T>(elements[i]); };
+        math_array_expressions::Unrolled<S>::for_each(evaluate);
+        store(values);
+        return *this;
+    }
+
+    /**
+     * Type of the norms of the array: floating point arrays keep their precision, integral arrays use double.
+     */
+    using NormType = typename std::conditional<std::is_floating_point<T>::value, T, double>::type;
+
+    /**
+     * Compute the squared euclidian norm of the array.
+     *
+     * Only multiply-adds are performed, so this method should be preferred to norm() when comparing the norm to a
+     * threshold.
+     * @return squared euclidian norm of the array.
+     */
+    NormType squared_norm() const {
+        NormType squared_norm{0};
+        for(std::size_t i{0}; i < S; ++i) {
+            squared_norm += static_cast<NormType>((*this)[i]) * static_cast<NormType>((*this)[i]);
+        }
+        return squared_norm;
+    }
+
+    /**
+     * Compute the euclidian norm of the array with a single square root.
+     * @return euclidian norm of the array.
+     */
+    NormType norm2() const {
+        return std::sqrt(squared_norm());
+    }
+
+    /**
+     * Compute the p-norm of the array for an integer p known at compile time.
+     *
+     * The powers are computed with multiplications, only the final root calls std::pow (and not even that for
+     * p=1 and p=2).
+     * @tparam P parameter of the norm, should be strictly positive.
+     * @return   p-norm of the array.
+     */
+    template <unsigned int P>
+    NormType norm_p() const {
+        static_assert(P > 0, "The parameter of a p-norm should be strictly positive.");
+        if(P == 2) {
+            return norm2();
+        }
+        NormType norm{0};
+        for(std::size_t i{0}; i < S; ++i) {
+            const NormType absolute_value{static_cast<NormType>((*this)[i]) < 0 ? -static_cast<NormType>((*this)[i])
+                                                                                 :  static_cast<NormType>((*this)[i])};
+            NormType power{absolute_value};
+            for(unsigned int k{1}; k < P; ++k) {
+                power *= absolute_value;
+            }
+            norm += power;
+        }
+        if(P == 1) {
+            return norm;
+        }
+        return std::pow(norm, NormType{1} / static_cast<NormType>(P));
+    }
+
     /**
      * Compute the p-norm of the array.
      * @param p parameter of the norm. p=2.0 is the euclidian norm and is the default behaviour.
      * @return  p-norm of the array.
      */
     double norm(double p = 2.0) const {
+        if(p == 2.0) {
+            return static_cast<double>(norm2());
+        }
         double norm{0.0};
         for(std::size_t i{0}; i < S; ++i) {
             norm += std::pow((*this)[i], p);
@@ -57,122 +195,135 @@ public:
 
     /**
      * Soustraction logic for the MathArray class.
-     * @tparam T2   type of the stored elements of the array to substract.
+     * @tparam E    type of the array (or array expression) to substract.
      * @param array the array to substract.
      * @return      the updated current instance.
      */
-    template <typename T2>
-    MathArray<T, S> operator-=(const MathArray<T2, S> & array) {
-        for(std::size_t i{0}; i < S; ++i) {
-            (*this)[i] -= array[i];
-        }
+    template <typename E>
+    MathArray<T, S> & operator-=(const MathArrayExpression<E, S> & array) {
+        const E & elements = array.derived();
+        T values[S];
+        auto evaluate = [this, &values, &elements](std::size_t i) { values[i] = (*this)[i] - elements[i]; };
+        math_array_expressions::Unrolled<S>::for_each(evaluate);
+        store(values);
         return *this;
-    };
+    }
 
     /**
      * Soustraction logic for the MathArray class.
-     * @tparam T2   type of the stored elements of the array to substract.
-     * @param array the array to substract.
-     * @return      the updated current instance.
+     * @tparam T2     type of the scalar to substract.
+     * @param element the scalar to substract to each element.
+     * @return        the updated current instance.
      */
     template <typename T2>
-    MathArray<T, S> operator-=(const T2 & element) {
+    typename std::enable_if<std::is_arithmetic<T2>::value, MathArray<T, S> &>::type operator-=(const T2 & element) {
         for(std::size_t i{0}; i < S; ++i) {
             (*this)[i] -= element;
         }
         return *this;
-    };
-
+    }
 
     /**
      * Addition logic for the MathArray class.
-     * @tparam T2   type of the stored elements of the array to add.
+     * @tparam E    type of the array (or array expression) to add.
      * @param array the array to add.
      * @return      the updated current instance.
      */
-    template <typename T2>
-    MathArray<T, S> operator+=(const MathArray<T2, S> & array) {
-        for(std::size_t i{0}; i < S; ++i) {
-            (*this)[i] += array[i];
-        }
+    template <typename E>
+    MathArray<T, S> & operator+=(const MathArrayExpression<E, S> & array) {
+        const E & elements = array.derived();
+        T values[S];
+        auto evaluate = [this, &values, &elements](std::size_t i) { values[i] = (*this)[i] + elements[i]; };
+        math_array_expressions::Unrolled<S>::for_each(evaluate);
+        store(values);
         return *this;
-    };
+    }
 
     /**
      * Addition logic for the MathArray class.
-     * @tparam T2   type of the stored elements of the array to add.
-     * @param array the array to add.
-     * @return      the updated current instance.
+     * @tparam T2     type of the scalar to add.
+     * @param element the scalar to add to each element.
+     * @return        the updated current instance.
      */
     template <typename T2>
-    MathArray<T, S> operator+=(const T2 & element) {
+    typename std::enable_if<std::is_arithmetic<T2>::value, MathArray<T, S> &>::type operator+=(const T2 & element) {
         for(std::size_t i{0}; i < S; ++i) {
             (*this)[i] += element;
         }
         return *this;
-    };
+    }
 
     /**
      * Multiplication logic for the MathArray class.
-     * @tparam T2   type of the stored elements of the array to multiply.
+     * @tparam E    type of the array (or array expression) to multiply.
      * @param array the array to multiply.
      * @return      the updated current instance.
      */
-    template <typename T2>
-    MathArray<T, S> operator*=(const MathArray<T2, S> & array) {
-        for(std::size_t i{0}; i < S; ++i) {
-            (*this)[i] *= array[i];
-        }
+    template <typename E>
+    MathArray<T, S> & operator*=(const MathArrayExpression<E, S> & array) {
+        const E & elements = array.derived();
+        T values[S];
+        auto evaluate = [this, &values, &elements](std::size_t i) { values[i] = (*this)[i] * elements[i]; };
+        math_array_expressions::Unrolled<S>::for_each(evaluate);
+        store(values);
         return *this;
-    };
+    }
 
     /**
      * Multiplication logic for the MathArray class.
-     * @tparam T2   type of the stored elements of the array to multiply.
-     * @param array the array to multiply.
-     * @return      the updated current instance.
+     * @tparam T2     type of the scalar to multiply.
+     * @param element the scalar to multiply to each element.
+     * @return        the updated current instance.
      */
     template <typename T2>
-    MathArray<T, S> operator*=(const T2 & element) {
+    typename std::enable_if<std::is_arithmetic<T2>::value, MathArray<T, S> &>::type operator*=(const T2 & element) {
         for(std::size_t i{0}; i < S; ++i) {
             (*this)[i] *= element;
         }
         return *this;
-    };
-
+    }
 
     /**
      * Division logic for the MathArray class.
-     * @tparam T2   type of the stored elements of the array to divide.
+     * @tparam E    type of the array (or array expression) to divide.
      * @param array the array to divide.
      * @return      the updated current instance.
      */
-    template <typename T2>
-    MathArray<T, S> operator/=(const MathArray<T2, S> & array) {
-        for(std::size_t i{0}; i < S; ++i) {
-            (*this)[i] /= array[i];
-        }
+    template <typename E>
+    MathArray<T, S> & operator/=(const MathArrayExpression<E, S> & array) {
+        const E & elements = array.derived();
+        T values[S];
+        auto evaluate = [this, &values, &elements](std::size_t i) { values[i] = (*this)[i] / elements[i]; };
+        math_array_expressions::Unrolled<S>::for_each(evaluate);
+        store(values);
         return *this;
-    };
+    }
 
     /**
      * Division logic for the MathArray class.
-     * @tparam T2   type of the stored elements of the array to division.
-     * @param array the array to division.
-     * @return      the updated current instance.
+     * @tparam T2     type of the scalar to divide.
+     * @param element the scalar to divide to each element.
+     * @return        the updated current instance.
      */
     template <typename T2>
-    MathArray<T, S> operator/=(const T2 & element) {
+    typename std::enable_if<std::is_arithmetic<T2>::value, MathArray<T, S> &>::type operator/=(const T2 & element) {
         for(std::size_t i{0}; i < S; ++i) {
             (*this)[i] /= element;
         }
         return *this;
-    };
-
-};
+    }
 
+private:
 
-//#include "MathArrayOperators.tpp"
+    /**
+     * Copy the evaluated elements of an expression into the array.
+     * @param values the evaluated elements.
+     */
+    void store(const T (&values)[S]) {
+        auto copy = [this, &values](std::size_t i) { (*this)[i] = values[i]; };
+        math_array_expressions::Unrolled<S>::for_each(copy);
+    }
+};
 
 
 template <typename T1, typename T2, std::size_t S>
@@ -189,134 +340,6 @@ bool operator!=(const MathArray<T1, S> & lhs, const MathArray<T2, S> & rhs) {
 };
 
 
-/*
- * Addition
- */
-template <typename T, typename U, std::size_t S>
-MathArray<T,S> operator+(const MathArray<T,S> & lhs, const MathArray<U,S> & rhs) {
-    MathArray<T,S> copy(lhs);
-    copy += rhs;
-    return copy;
-};
-
-template <typename T, typename U, std::size_t S>
-MathArray<T,S> operator+(MathArray<T,S> && lhs, MathArray<U,S> && rhs) {
-    MathArray<T,S> copy(std::forward<MathArray<T,S>>(lhs));
-    copy += rhs;
-    return copy;
-};
-
-template <typename T, typename U, std::size_t S>
-MathArray<T,S> operator+(const MathArray<T,S> & lhs, const U & rhs) {
-    MathArray<T,S> copy(lhs);
-    copy += rhs;
-    return copy;
-};
-
-template <typename T, typename U, std::size_t S>
-MathArray<U,S> operator+(T lhs, const MathArray<U,S> & rhs) {
-    MathArray<U,S> copy(rhs);
-    copy += lhs;
-    return copy;
-};
-
-
-/*
- * Substraction
- */
-template <typename T, typename U, std::size_t S>
-MathArray<T,S> operator-(const MathArray<T,S> & lhs, const MathArray<U,S> & rhs) {
-    MathArray<T,S> copy(lhs);
-    copy -= rhs;
-    return copy;
-};
-
-template <typename T, typename U, std::size_t S>
-MathArray<T,S> operator-(MathArray<T,S> && lhs, MathArray<U,S> && rhs) {
-    MathArray<T,S> copy(std::forward<MathArray<T,S>>(lhs));
-    copy -= rhs;
-    return copy;
-};
-
-
-template <typename T, typename U, std::size_t S>
-MathArray<T,S> operator-(const MathArray<T,S> & lhs, const U & rhs) {
-    MathArray<T,S> copy(lhs);
-    copy -= rhs;
-    return copy;
-};
-
-template <typename T, typename U, std::size_t S>
-MathArray<U,S> operator-(T lhs, const MathArray<U,S> & rhs) {
-    MathArray<U,S> copy(rhs);
-    copy -= lhs;
-    return copy;
-};
-
-
-/*
- * Multiplication
- */
-template <typename T, typename U, std::size_t S>
-MathArray<T,S> operator*(const MathArray<T,S> & lhs, const MathArray<U,S> & rhs) {
-    MathArray<T,S> copy(lhs);
-    copy *= rhs;
-    return copy;
-};
-
-template <typename T, typename U, std::size_t S>
-MathArray<T,S> operator*(MathArray<T,S> && lhs, MathArray<U,S> && rhs) {
-    MathArray<T,S> copy(std::forward<MathArray<T,S>>(lhs));
-    copy *= rhs;
-    return copy;
-};
-
-template <typename T, typename U, std::size_t S>
-MathArray<T,S> operator*(const MathArray<T,S> & lhs, const U & rhs) {
-    MathArray<T,S> copy(lhs);
-    copy *= rhs;
-    return copy;
-};
-
-template <typename T, typename U, std::size_t S>
-MathArray<U,S> operator*(T lhs, const MathArray<U,S> & rhs) {
-    MathArray<U,S> copy(rhs);
-    copy *= lhs;
-    return copy;
-};
-
-
-/*
- * Division
- */
-template <typename T, typename U, std::size_t S>
-MathArray<T,S> operator/(const MathArray<T,S> & lhs, const MathArray<U,S> & rhs) {
-    MathArray<T,S> copy(lhs);
-    copy /= rhs;
-    return copy;
-};
-
-template <typename T, typename U, std::size_t S>
-MathArray<T,S> operator/(MathArray<T,S> && lhs, MathArray<U,S> && rhs) {
-    MathArray<T,S> copy(std::forward<MathArray<T,S>>(lhs));
-    copy /= rhs;
-    return copy;
-};
-
-template <typename T, typename U, std::size_t S>
-MathArray<T,S> operator/(const MathArray<T,S> & lhs, const U & rhs) {
-    MathArray<T,S> copy(lhs);
-    copy /= rhs;
-    return copy;
-};
-
-template <typename T, typename U, std::size_t S>
-MathArray<U,S> operator/(T lhs, const MathArray<U,S> & rhs) {
-    MathArray<U,S> copy(rhs);
-    copy /= lhs;
-    return copy;
-};
-
-
+#include "MathArrayOperators.tpp"
 
 #endif //SWARMING_PROJECT_MATHARRAY_H
@@ -3,130 +3,216 @@
  *******************************************************/
 
 /*
- * Addition
+ * The arithmetic operators between MathArray instances (and scalars) build expression objects instead of computing
+ * a new MathArray. For example "m_force += COHESION_NORMALISER * (center - m_position)" builds the expression
+ * COHESION_NORMALISER * (center - m_position) and evaluates it element by element in the loop of operator+=.
+ *
+ * The expressions store the MathArray operands by reference and the sub-expressions and scalars by value, so an
+ * expression should be evaluated before the end of the statement that created it. In particular, never store an
+ * expression in an "auto" variable: assign it to a MathArray.
  */
-template <typename T, typename U, std::size_t S>
-MathArray<T,S> operator+(const MathArray<T,S> & lhs, const MathArray<U,S> & rhs) {
-    MathArray<T,S> copy(lhs);
-    copy += rhs;
-    return copy;
-};
+namespace math_array_expressions {
+
+    /**
+     * Scalar operand of an expression, seen as an array whose elements are all equal to the scalar.
+     * @tparam T type of the scalar.
+     */
+    template <typename T>
+    class ScalarOperand {
+
+    public:
+
+        using value_type = T;
+
+        ScalarOperand(const T & value) : m_value(value) { }
+
+        T operator[](std::size_t) const {
+            return m_value;
+        }
+
+    private:
+
+        T m_value;
+    };
+
+    /**
+     * How an operand is stored in an expression: MathArrays by reference, everything else (sub-expressions and
+     * scalar operands, which are small) by value.
+     */
+    template <typename E>
+    struct Storage {
+        using type = const E;
+    };
+
+    template <typename T, std::size_t S>
+    struct Storage< MathArray<T, S> > {
+        using type = const MathArray<T, S> &;
+    };
+
+    /**
+     * Type of the elements of an expression: as for the compound operators, the type of the elements of the left
+     * array wins, and the type of the array wins over the one of a scalar.
+     */
+    template <typename Lhs, typename Rhs>
+    struct ValueType {
+        using type = typename Lhs::value_type;
+    };
+
+    template <typename T, typename Rhs>
+    struct ValueType<ScalarOperand<T>, Rhs> {
+        using type = typename Rhs::value_type;
+    };
+
+    struct Addition {
+        template <typename T, typename U>
+        static auto apply(const T & lhs, const U & rhs) -> decltype(lhs + rhs) { return lhs + rhs; }
+    };
+
+    struct Substraction {
+        template <typename T, typename U>
+        static auto apply(const T & lhs, const U & rhs) -> decltype(lhs - rhs) { return lhs - rhs; }
+    };
+
+    struct Multiplication {
+        template <typename T, typename U>
+        static auto apply(const T & lhs, const U & rhs) -> decltype(lhs * rhs) { return lhs * rhs; }
+    };
+
+    struct Division {
+        template <typename T, typename U>
+        static auto apply(const T & lhs, const U & rhs) -> decltype(lhs / rhs) { return lhs / rhs; }
+    };
+
+    /**
+     * Lazy element-wise operation between two operands.
+     * @tparam Operation the element-wise operation (Addition, Substraction, Multiplication or Division).
+     * @tparam Lhs       type of the left operand: a MathArray, an expression or a ScalarOperand.
+     * @tparam Rhs       type of the right operand: a MathArray, an expression or a ScalarOperand.
+     * @tparam S         number of elements of the expression.
+     */
+    template <typename Operation, typename Lhs, typename Rhs, std::size_t S>
+    class BinaryExpression : public MathArrayExpression<BinaryExpression<Operation, Lhs, Rhs, S>, S> {
+
+    public:
+
+        using value_type = typename ValueType<Lhs, Rhs>::type;
+
+        BinaryExpression(const Lhs & lhs, const Rhs & rhs) : m_lhs(lhs), m_rhs(rhs) { }
+
+        /**
+         * Compute the i-th element of the expression.
+         * @param i index of the element.
+         * @return  the i-th element of the expression.
+         */
+        value_type operator[](std::size_t i) const {
+            return static_cast<value_type>(Operation::apply(m_lhs[i], m_rhs[i]));
+        }
+
+    private:
+
+        typename Storage<Lhs>::type m_lhs;
+        typename Storage<Rhs>::type m_rhs;
+    };
+
+    /**
+     * Type of the expressions built by the operators below.
+     */
+    template <typename Operation, typename E1, typename E2, std::size_t S>
+    using ArrayArray  = BinaryExpression<Operation, E1, E2, S>;
+
+    template <typename Operation, typename E, typename U, std::size_t S>
+    using ArrayScalar = typename std::enable_if<std::is_arithmetic<U>::value,
+                                                BinaryExpression<Operation, E, ScalarOperand<U>, S> >::type;
+
+    template <typename Operation, typename U, typename E, std::size_t S>
+    using ScalarArray = typename std::enable_if<std::is_arithmetic<U>::value,
+                                                BinaryExpression<Operation, ScalarOperand<U>, E, S> >::type;
+}
 
-template <typename T, typename U, std::size_t S>
-MathArray<T,S> operator+(MathArray<T,S> && lhs, MathArray<U,S> && rhs) {
-    MathArray<T,S> copy(std::forward<MathArray<T,S>>(lhs));
-    copy += rhs;
-    return copy;
+
+/*
+ * Addition
+ */
+template <typename E1, typename E2, std::size_t S>
+math_array_expressions::ArrayArray<math_array_expressions::Addition, E1, E2, S>
+operator+(const MathArrayExpression<E1, S> & lhs, const MathArrayExpression<E2, S> & rhs) {
+    return {lhs.derived(), rhs.derived()};
 };
 
-template <typename T, typename U, std::size_t S>
-MathArray<T,S> operator+(const MathArray<T,S> & lhs, const U & rhs) {
-    MathArray<T,S> copy(lhs);
-    copy += rhs;
-    return copy;
+template <typename E, typename U, std::size_t S>
+math_array_expressions::ArrayScalar<math_array_expressions::Addition, E, U, S>
+operator+(const MathArrayExpression<E, S> & lhs, const U & rhs) {
+    return {lhs.derived(), rhs};
 };
 
-template <typename T, typename U, std::size_t S>
-MathArray<U,S> operator+(T lhs, const MathArray<U,S> & rhs) {
-    MathArray<T,S> copy(rhs);
-    copy += lhs;
-    return copy;
+template <typename U, typename E, std::size_t S>
+math_array_expressions::ScalarArray<math_array_expressions::Addition, U, E, S>
+operator+(const U & lhs, const MathArrayExpression<E, S> & rhs) {
+    return {lhs, rhs.derived()};
 };
 
 
 /*
  * Substraction
  */
-template <typename T, typename U, std::size_t S>
-MathArray<T,S> operator-(const MathArray<T,S> & lhs, const MathArray<U,S> & rhs) {
-    MathArray<T,S> copy(lhs);
-    copy -= rhs;
-    return copy;
-};
-
-template <typename T, typename U, std::size_t S>
-MathArray<T,S> operator-(MathArray<T,S> && lhs, MathArray<U,S> && rhs) {
-    MathArray<T,S> copy(std::forward<MathArray<T,S>>(lhs));
-    copy -= rhs;
-    return copy;
+template <typename E1, typename E2, std::size_t S>
+math_array_expressions::ArrayArray<math_array_expressions::Substraction, E1, E2, S>
+operator-(const MathArrayExpression<E1, S> & lhs, const MathArrayExpression<E2, S> & rhs) {
+    return {lhs.derived(), rhs.derived()};
 };
 
-
-template <typename T, typename U, std::size_t S>
-MathArray<T,S> operator-(const MathArray<T,S> & lhs, const U & rhs) {
-    MathArray<T,S> copy(lhs);
-    copy -= rhs;
-    return copy;
+template <typename E, typename U, std::size_t S>
+math_array_expressions::ArrayScalar<math_array_expressions::Substraction, E, U, S>
+operator-(const MathArrayExpression<E, S> & lhs, const U & rhs) {
+    return {lhs.derived(), rhs};
 };
 
-template <typename T, typename U, std::size_t S>
-MathArray<U,S> operator-(T lhs, const MathArray<U,S> & rhs) {
-    MathArray<T,S> copy(rhs);
-    copy -= lhs;
-    return copy;
+template <typename U, typename E, std::size_t S>
+math_array_expressions::ScalarArray<math_array_expressions::Substraction, U, E, S>
+operator-(const U & lhs, const MathArrayExpression<E, S> & rhs) {
+    return {lhs, rhs.derived()};
 };
 
 
 /*
  * Multiplication
  */
-template <typename T, typename U, std::size_t S>
-MathArray<T,S> operator*(const MathArray<T,S> & lhs, const MathArray<U,S> & rhs) {
-    MathArray<T,S> copy(lhs);
-    copy *= rhs;
-    return copy;
-};
-
-template <typename T, typename U, std::size_t S>
-MathArray<T,S> operator*(MathArray<T,S> && lhs, MathArray<U,S> && rhs) {
-    MathArray<T,S> copy(std::forward<MathArray<T,S>>(lhs));
-    copy *= rhs;
-    return copy;
+template <typename E1, typename E2, std::size_t S>
+math_array_expressions::ArrayArray<math_array_expressions::Multiplication, E1, E2, S>
+operator*(const MathArrayExpression<E1, S> & lhs, const MathArrayExpression<E2, S> & rhs) {
+    return {lhs.derived(), rhs.derived()};
 };
 
-template <typename T, typename U, std::size_t S>
-MathArray<T,S> operator*(const MathArray<T,S> & lhs, const U & rhs) {
-    MathArray<T,S> copy(lhs);
-    copy *= rhs;
-    return copy;
+template <typename E, typename U, std::size_t S>
+math_array_expressions::ArrayScalar<math_array_expressions::Multiplication, E, U, S>
+operator*(const MathArrayExpression<E, S> & lhs, const U & rhs) {
+    return {lhs.derived(), rhs};
 };
 
-template <typename T, typename U, std::size_t S>
-MathArray<U,S> operator*(T lhs, const MathArray<U,S> & rhs) {
-    MathArray<T,S> copy(rhs);
-    copy *= lhs;
-    return copy;
+template <typename U, typename E, std::size_t S>
+math_array_expressions::ScalarArray<math_array_expressions::Multiplication, U, E, S>
+operator*(const U & lhs, const MathArrayExpression<E, S> & rhs) {
+    return {lhs, rhs.derived()};
 };
 
 
 /*
  * Division
  */
-template <typename T, typename U, std::size_t S>
-MathArray<T,S> operator/(const MathArray<T,S> & lhs, const MathArray<U,S> & rhs) {
-    MathArray<T,S> copy(lhs);
-    copy /= rhs;
-    return copy;
+template <typename E1, typename E2, std::size_t S>
+math_array_expressions::ArrayArray<math_array_expressions::Division, E1, E2, S>
+operator/(const MathArrayExpression<E1, S> & lhs, const MathArrayExpression<E2, S> & rhs) {
+    return {lhs.derived(), rhs.derived()};
 };
 
-template <typename T, typename U, std::size_t S>
-MathArray<T,S> operator/(MathArray<T,S> && lhs, MathArray<U,S> && rhs) {
-    MathArray<T,S> copy(std::forward<MathArray<T,S>>(lhs));
-    copy /= rhs;
-    return copy;
+template <typename E, typename U, std::size_t S>
+math_array_expressions::ArrayScalar<math_array_expressions::Division, E, U, S>
+operator/(const MathArrayExpression<E, S> & lhs, const U & rhs) {
+    return {lhs.derived(), rhs};
 };
 
-template <typename T, typename U, std::size_t S>
-MathArray<T,S> operator/(const MathArray<T,S> & lhs, const U & rhs) {
-    MathArray<T,S> copy(lhs);
-    copy /= rhs;
-    return copy;
+template <typename U, typename E, std::size_t S>
+math_array_expressions::ScalarArray<math_array_expressions::Division, U, E, S>
+operator/(const U & lhs, const MathArrayExpression<E, S> & rhs) {
+    return {lhs, rhs.derived()};
 };
-
-template <typename T, typename U, std::size_t S>
-MathArray<U,S> operator/(T lhs, const MathArray<U,S> & rhs) {
-    MathArray<T,S> copy(rhs);
-    copy /= lhs;
-    return copy;
-};
-
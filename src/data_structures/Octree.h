@@ -3,9 +3,13 @@
 
 #include "definitions/types.h"
 #include "definitions/constants.h"
+#include "definitions/mpi_types.h"
 #include "data_structures/Boid.h"
 #include "algorithms/sample_sort.h"
+#include "algorithms/radix_sort.h"
 #include "algorithms/morton_index.h"
+#include <cmath>
+#include <algorithm>
 
 
 
@@ -20,8 +24,17 @@ template <std::size_t Dimension>
 class Octree {
 
 public:
+    /**
+    * Type of the Morton index of an octant: bits [0, 5) hold the depth, the bits above hold the interleaved anchor
+    * coordinates, from the finest level of the tree (lowest bits) to the root level (highest bits).
+    */
+    using MortonIndexType = std::size_t;
+
+    // The anchor and the depth are kept alongside the Morton index they encode: they must only be set through the
+    // constructors so that the three members stay consistent.
     std::size_t m_depth{};
     Coordinate<Dimension> m_anchor;
+    MortonIndexType m_morton_index{};
 
     Octree() = default;
 
@@ -31,8 +44,9 @@ public:
     * @param anchor The number of randomly-distributed boids initially in the grid.
     */
     Octree(Coordinate<Dimension> const & anchor, std::size_t const & depth)
-            : m_anchor(anchor),
-              m_depth(depth)
+            : m_depth(depth),
+              m_anchor(anchor),
+              m_morton_index(get_morton_index(anchor, depth))
     { }
 
     /**
@@ -46,13 +60,25 @@ public:
         // TODO: we can use vectorisation here if we define the static_cast (or the cast) operation on a vector.
         for (std::size_t i{0}; i < Dimension; ++i)
             m_anchor[i] = static_cast<int>(boid.m_position[i] / case_size);
+        m_morton_index = get_morton_index(m_anchor, m_depth);
+    }
+
+    /**
+    * Build the octant encoded by a Morton index.
+    * @param morton_index Morton index of the octant, as returned by morton_index().
+    * @return the octant whose Morton index is @a morton_index.
+    */
+    static Octree<Dimension> from_morton_index(MortonIndexType morton_index) {
+        return Octree<Dimension>(morton_index,
+                                 Coordinate<Dimension>(get_anchor_from_morton_index<CoordinateType, Dimension>(morton_index)),
+                                 get_depth_from_morton_index(morton_index));
     }
 
     /**
-    * Computes the morton index.
+    * Returns the morton index, computed once at construction.
     */
-    std::size_t morton_index() const{
-        return get_morton_index(m_anchor, m_depth);
+    MortonIndexType morton_index() const{
+        return m_morton_index;
     }
 
     /**
@@ -60,15 +86,7 @@ public:
     * @param poss_father Possible father
     */
     bool is_child(Octree<Dimension> const & poss_father) const{
-        if (m_depth != poss_father.m_depth+1){
-            return false;
-        }
-        for (int i = 0; i<Dimension; i++){
-            if ((m_anchor[i] != poss_father.m_anchor[i]) && (m_anchor[i] != poss_father.m_anchor[i]+(1<<(constants::Dmax-m_depth)))){
-                return false;
-            }
-        }
-        return true;
+        return m_depth == poss_father.m_depth + 1 && has_prefix(poss_father);
     }
 
     /**
@@ -76,14 +94,9 @@ public:
     * @param poss_ancestor Possible ancestor
     */
     int is_descendant(Octree<Dimension> const & poss_ances) const{
-        if (m_depth <= poss_ances.m_depth){
+        if (m_depth <= poss_ances.m_depth || !has_prefix(poss_ances)){
             return 0;
         }
-        for (int i = 0; i<Dimension; i++){
-            if ((m_anchor[i] < poss_ances.m_anchor[i]) || (m_anchor[i] >= poss_ances.m_anchor[i]+(1<<(constants::Dmax-poss_ances.m_depth)))){
-                return 0;
-            }
-        }
         return static_cast<int>(m_depth) - static_cast<int>(poss_ances.m_depth);
     }
 
@@ -112,13 +125,7 @@ public:
             std::cerr << "WARNING: requesting father of a node at depth 0" << std::endl;
         }
 #endif
-        Coordinate<Dimension> anchor = m_anchor;
-        const int case_size_minus_1 = (1 << (constants::Dmax-m_depth+1)) - 1;
-        for(int i = 0; i<Dimension; i++){
-            anchor[i] -= (anchor[i] & case_size_minus_1);
-        }
-        Octree<Dimension> father(anchor, m_depth-1);
-        return father;
+        return get_ancestor(m_depth - 1);
     }
 
     /**
@@ -131,18 +138,18 @@ public:
             std::cerr << "WARNING: bad octant order" << std::endl;
         }
 #endif
-        Octree<Dimension> curr_ances(m_anchor, m_depth);
-        while (! curr_ances.is_ancestor(b)) {
-            curr_ances = curr_ances.get_father();
+        // The closest ancestor is the deepest level strictly above b whose prefix is shared by both Morton indices.
+        std::size_t depth{std::min(m_depth, b.m_depth == 0 ? 0 : b.m_depth - 1)};
+        while (depth > 0 && (m_morton_index >> level_shift(depth)) != (b.m_morton_index >> level_shift(depth))) {
+            --depth;
         }
-        return curr_ances;
+        return get_ancestor(depth);
     }
 
     /**
-    * Returns the vector containing every children of the current octree.
+    * Returns the vector containing every children of the current octree, in Morton order.
     */
     std::vector<Octree<Dimension>> get_children() const{
-        // TODO: check that the returned children are ordered!
 #ifdef SWARMING_DO_ALL_CHECKS
         if (m_depth == Dmax){
             std::cerr << "WARNING: Requesting children of a node at depth Dmax" << std::endl;
@@ -151,21 +158,22 @@ public:
         std::vector<Octree<Dimension>> children;
         children.reserve(1ULL << Dimension);
 
+        // The number of the child is written just below the prefix of the father in the Morton index.
+        unsigned const shift{level_shift(m_depth + 1)};
+        MortonIndexType const prefix{(m_morton_index & ~MortonIndexType{0x1F}) | (m_depth + 1)};
+        std::size_t const case_size{1ULL << (Dmax-m_depth-1)};
         for (std::size_t i{0}; i < (1ULL << Dimension); ++i) {
-            Octree<Dimension> child(m_anchor, m_depth + 1);
-
-            std::size_t case_size = (1ULL << (Dmax-m_depth-1));
+            Coordinate<Dimension> anchor{m_anchor};
             for (std::size_t j{0}; j < Dimension; ++j){
-                child.m_anchor[j] += ((i >> j) & 1)*case_size;
+                anchor[j] += ((i >> j) & 1)*case_size;
             }
-            children.push_back(child);
+            children.push_back(Octree<Dimension>(prefix | (static_cast<MortonIndexType>(i) << shift), anchor, m_depth + 1));
         }
         return(children);
     }
 
     Octree<Dimension> get_dfd() const{
-        Octree<Dimension> dfd(m_anchor, constants::Dmax);
-        return dfd;
+        return Octree<Dimension>((m_morton_index & ~MortonIndexType{0x1F}) | constants::Dmax, m_anchor, constants::Dmax);
     }
 
     Octree<Dimension> get_dld() const{
@@ -174,8 +182,10 @@ public:
         for (int k=0; k<Dimension; k++){
             anchor[k] += case_size - 1;
         }
-        Octree<Dimension> dld(anchor, constants::Dmax);
-        return(dld);
+        // The deepest last descendant sets every anchor bit below the prefix of the current octant.
+        MortonIndexType const descendant_bits{(MortonIndexType{1} << level_shift(m_depth)) - 1};
+        return Octree<Dimension>(((m_morton_index | descendant_bits) & ~MortonIndexType{0x1F}) | constants::Dmax,
+                                 anchor, constants::Dmax);
     }
 
     std::vector<Octree<Dimension>> get_siblings() const {
@@ -189,26 +199,68 @@ public:
         return siblings;
     }
 
+private:
+    /**
+    * Constructor from already consistent members, used to build related octants without interleaving the bits.
+    */
+    Octree(MortonIndexType morton_index, Coordinate<Dimension> const & anchor, std::size_t depth)
+            : m_depth(depth),
+              m_anchor(anchor),
+              m_morton_index(morton_index)
+    { }
+
+    /**
+    * Position of the lowest Morton index bit holding the anchor of an octant of the given depth: the bits at and
+    * above this position identify the octant among the octants of its depth.
+    * @param depth depth of an octant, between 0 and Dmax.
+    */
+    static unsigned level_shift(std::size_t depth) {
+        return static_cast<unsigned>(5 + Dimension * (constants::Dmax - depth));
+    }
+
+    /**
+    * Returns true if the anchor bits of the argument octant are a prefix of the anchor bits of the current octant.
+    * @param other an octant that is not deeper than the current octant.
+    */
+    bool has_prefix(Octree<Dimension> const & other) const {
+        unsigned const shift{level_shift(other.m_depth)};
+        return shift >= 8 * sizeof(MortonIndexType) || (m_morton_index >> shift) == (other.m_morton_index >> shift);
+    }
+
+    /**
+    * Returns the ancestor of the current octant at the given depth.
+    * @param depth depth of the ancestor, lower or equal to the depth of the current octant.
+    */
+    Octree<Dimension> get_ancestor(std::size_t depth) const {
+        unsigned const shift{level_shift(depth)};
+        MortonIndexType const prefix{shift >= 8 * sizeof(MortonIndexType) ? 0 : (m_morton_index >> shift) << shift};
+        Coordinate<Dimension> anchor = m_anchor;
+        CoordinateType const case_size_minus_1{(CoordinateType{1} << (constants::Dmax - depth)) - 1};
+        for (std::size_t i{0}; i < Dimension; ++i) {
+            anchor[i] &= ~case_size_minus_1;
+        }
+        return Octree<Dimension>(prefix | depth, anchor, depth);
+    }
 };
 
 template <std::size_t Dimension>
 bool operator==(const Octree<Dimension> & oct1, const Octree<Dimension> & oct2) {
-    return oct1.m_depth == oct2.m_depth && oct1.m_anchor == oct2.m_anchor;
+    return oct1.m_morton_index == oct2.m_morton_index;
 }
 
 template <std::size_t Dimension>
 bool operator!=(const Octree<Dimension> & oct1, const Octree<Dimension> & oct2) {
-    return oct1.m_depth != oct2.m_depth || oct1.m_anchor != oct2.m_anchor;
+    return oct1.m_morton_index != oct2.m_morton_index;
 }
 
 template <std::size_t Dimension>
 bool operator<(const Octree<Dimension> & oct1, const Octree<Dimension> & oct2) {
-    return(oct1.morton_index() < oct2.morton_index());
+    return(oct1.m_morton_index < oct2.m_morton_index);
 };
 
 template <std::size_t Dimension>
 bool operator>(const Octree<Dimension> & oct1, const Octree<Dimension> & oct2) {
-    return(oct1.morton_index() > oct2.morton_index());
+    return(oct1.m_morton_index > oct2.m_morton_index);
 };
 
 template <std::size_t D>
@@ -217,19 +269,71 @@ std::ostream & operator<<(std::ostream & os, Octree<D> const & octree) {
 }
 
 /**
- * Redefinition of numeric_limits<Octree<Dim>>::max() for the sort algorithm.
+ * Compute the octant of depth Dmax that contains the given position.
+ *
+ * Positions outside of the simulated space are mapped to the closest octant on the border.
+ * @tparam Dimension dimension of the simulated space.
+ * @param position a position, possibly outside of the simulated space.
+ * @return the octant of depth Dmax containing @a position.
  */
-namespace std {
-    template<>
-    template<std::size_t Dim>
-    class numeric_limits<Octree<Dim>> {
-    public:
-        static Octree<Dim> max() {
-            Coordinate<Dim> anchor;
-            for(std::size_t i{0}; i < Dim; ++i) anchor[i] = static_cast<CoordinateType>(-1);
-            return Octree<Dim>(anchor, static_cast<CoordinateType>(-1));
-        }
-    };
+template <std::size_t Dimension>
+Octree<Dimension> leaf_octant(Position<Dimension> const & position) {
+    CoordinateType const number_of_leaves_per_side{CoordinateType{1} << constants::Dmax};
+    float const leaf_size{static_cast<float>(GRID_SIZE) / static_cast<float>(number_of_leaves_per_side)};
+
+    Coordinate<Dimension> anchor;
+    for(std::size_t d{0}; d < Dimension; ++d) {
+        float const coordinate{std::floor(position[d] / leaf_size)};
+        if(!(coordinate > 0.0f))
+            anchor[d] = 0;
+        else
+            anchor[d] = std::min(static_cast<CoordinateType>(coordinate), number_of_leaves_per_side - 1);
+    }
+    return Octree<Dimension>(anchor, constants::Dmax);
+}
+
+/**
+ * Compute the leaf octant of each boid (see leaf_octant), in parallel.
+ * @tparam Dimension dimension of the simulated space.
+ * @param boids the boids.
+ * @return the octant of each boid, in the order of @a boids.
+ */
+template <std::size_t Dimension>
+std::vector<Octree<Dimension>> boid_octants(std::vector<Boid<Dimension>> const & boids) {
+    std::vector<Octree<Dimension>> octants(boids.size());
+#pragma omp parallel for schedule(static)
+    for(std::size_t i = 0; i < boids.size(); ++i)
+        octants[i] = leaf_octant<Dimension>(boids[i].m_position);
+    return octants;
 }
 
+/**
+ * The octants are sorted by their cached Morton index.
+ */
+template <std::size_t Dim>
+struct RadixSortTraits< Octree<Dim> > {
+    static constexpr bool     available{true};
+    using key_type = unsigned long long;
+    static constexpr unsigned KEY_BITS{5 + Dim * constants::Dmax};
+
+    static key_type key(Octree<Dim> const & octant) {
+        return octant.morton_index();
+    }
+};
+
+/**
+ * The octants are sent member by member: the depth, the anchor and the Morton index.
+ */
+template <std::size_t Dim>
+struct MPIDatatype< Octree<Dim> > {
+    static constexpr bool predefined{false};
+
+    static MPI_Datatype create() {
+        Octree<Dim> const octant{};
+        return create_struct_datatype(octant, {&octant.m_depth, &octant.m_anchor, &octant.m_morton_index}, {1, 1, 1},
+                                      {mpi_datatype<std::size_t>(), mpi_datatype< Coordinate<Dim> >(),
+                                       mpi_datatype<typename Octree<Dim>::MortonIndexType>()});
+    }
+};
+
 #endif //SWARMING_PROJECT_OCTREE_H
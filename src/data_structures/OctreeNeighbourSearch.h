@@ -0,0 +1,165 @@
+#ifndef SWARMING_PROJECT_OCTREENEIGHBOURSEARCH_H
+#define SWARMING_PROJECT_OCTREENEIGHBOURSEARCH_H
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#include "definitions/types.h"
+#include "definitions/constants.h"
+#include "data_structures/Boid.h"
+#include "data_structures/Octree.h"
+
+using types::Position;
+using types::Coordinate;
+using types::CoordinateType;
+
+/**
+ * Neighbour search based on a linear octree.
+ *
+ * Each boid is associated with the octant of depth Dmax containing it, and the boids are sorted by the Morton index
+ * of this octant. With this ordering, the boids covered by any octant are stored contiguously, so the octree never
+ * needs to be stored explicitly: a query descends from the root, only visits the octants that intersect the
+ * VISION_DISTANCE ball around the boid, and computes the boids covered by each octant with a binary search.
+ *
+ * Contrary to the uniform cells of CellList, the octants adapt to the density of the boids, which keeps the
+ * number of tested boids low for dense and clustered flocks.
+ *
+ * @tparam Dimension dimension of the simulated space.
+ */
+template <std::size_t Dimension>
+class OctreeNeighbourSearch {
+
+public:
+
+    /**
+     * Sort the given boids by Morton index.
+     *
+     * This method should be called each time the boids moved and before any call to for_each_candidate.
+     * @param boids the boids to sort.
+     */
+    void rebuild(std::vector< Boid<Dimension> > const & boids) {
+        std::size_t const number_of_boids{boids.size()};
+        m_sorted_boids.resize(number_of_boids);
+
+        #pragma omp parallel for
+        for(std::size_t i = 0; i < number_of_boids; ++i) {
+            m_sorted_boids[i] = std::make_pair(leaf_octant<Dimension>(boids[i].m_position).morton_index(), i);
+        }
+        std::sort(m_sorted_boids.begin(), m_sorted_boids.end());
+    }
+
+    /**
+     * Call @a function on the index of each boid covered by a leaf octant that intersects the VISION_DISTANCE ball
+     * around @a position.
+     *
+     * Every boid within VISION_DISTANCE of @a position is guaranteed to be visited. Each boid is visited at most
+     * once.
+     *
+     * @tparam Function callable with a signature compatible with void(std::size_t).
+     * @param position the position around which we search the boids.
+     * @param function the function to call on each candidate boid index.
+     */
+    template <typename Function>
+    void for_each_candidate(Position<Dimension> const & position, Function && function) const {
+        struct Node {
+            Octree<Dimension> octant;
+            std::size_t       first;
+            std::size_t       last;
+        };
+
+        // Each level of the descent pushes at most 2^Dimension octants on the stack.
+        Node stack[constants::Dmax * (1ULL << Dimension) + 1];
+        std::size_t stack_size{0};
+
+        Coordinate<Dimension> root_anchor;
+        for(std::size_t d{0}; d < Dimension; ++d)
+            root_anchor[d] = 0;
+        stack[stack_size++] = Node{Octree<Dimension>(root_anchor, 0), 0, m_sorted_boids.size()};
+
+        while(stack_size > 0) {
+            Node const node = stack[--stack_size];
+
+            if(node.first == node.last || !intersects_vision(node.octant, position))
+                continue;
+
+            // Small or deepest octants: test all the covered boids.
+            if(node.last - node.first <= LEAF_SIZE || node.octant.m_depth == constants::Dmax) {
+                for(std::size_t k{node.first}; k < node.last; ++k)
+                    function(m_sorted_boids[k].second);
+                continue;
+            }
+
+            // Otherwise split the boids of this octant between its children. The children are enumerated in
+            // Morton order, so the boids they cover are consecutive.
+            CoordinateType const child_size{CoordinateType{1} << (constants::Dmax - node.octant.m_depth - 1)};
+            std::size_t child_first{node.first};
+            for(std::size_t child_number{0}; child_number < (1ULL << Dimension); ++child_number) {
+                Coordinate<Dimension> child_anchor = node.octant.m_anchor;
+                for(std::size_t d{0}; d < Dimension; ++d)
+                    child_anchor[d] += ((child_number >> d) & 1) * child_size;
+                Octree<Dimension> const child(child_anchor, node.octant.m_depth + 1);
+
+                // The boids covered by child have a Morton index in [first_key, next child's first_key).
+                std::size_t child_last{node.last};
+                if(child_number + 1 < (1ULL << Dimension)) {
+                    Coordinate<Dimension> next_anchor = node.octant.m_anchor;
+                    for(std::size_t d{0}; d < Dimension; ++d)
+                        next_anchor[d] += (((child_number + 1) >> d) & 1) * child_size;
+                    auto const next_key = Octree<Dimension>(next_anchor, constants::Dmax).morton_index();
+                    child_last = static_cast<std::size_t>(
+                            std::lower_bound(m_sorted_boids.begin() + child_first, m_sorted_boids.begin() + node.last,
+                                             std::make_pair(next_key, std::size_t{0})) - m_sorted_boids.begin());
+                }
+                stack[stack_size++] = Node{child, child_first, child_last};
+                child_first = child_last;
+            }
+        }
+    }
+
+private:
+
+    /**
+     * Number of boids under which an octant is not split anymore during a query.
+     */
+    static constexpr std::size_t LEAF_SIZE{16};
+
+    /**
+     * Tell whether the VISION_DISTANCE ball around @a position intersects the region covered by @a octant.
+     *
+     * The octants on the border of the simulated space are considered infinite towards the outside, because
+     * they also store the boids that left the simulated space.
+     * @param octant   the octant to test.
+     * @param position the center of the ball.
+     * @return true if the ball and the octant intersect, false otherwise.
+     */
+    static bool intersects_vision(Octree<Dimension> const & octant, Position<Dimension> const & position) {
+        CoordinateType const number_of_leaves_per_side{CoordinateType{1} << constants::Dmax};
+        float const leaf_size{static_cast<float>(GRID_SIZE) / static_cast<float>(number_of_leaves_per_side)};
+        CoordinateType const octant_size{CoordinateType{1} << (constants::Dmax - octant.m_depth)};
+
+        DistanceType squared_distance{0.0f};
+        for(std::size_t d{0}; d < Dimension; ++d) {
+            float const lower{octant.m_anchor[d] == 0 ? -std::numeric_limits<float>::infinity()
+                                                      : octant.m_anchor[d] * leaf_size};
+            float const upper{octant.m_anchor[d] + octant_size >= number_of_leaves_per_side
+                                                      ? std::numeric_limits<float>::infinity()
+                                                      : (octant.m_anchor[d] + octant_size) * leaf_size};
+            if(position[d] < lower)
+                squared_distance += (lower - position[d]) * (lower - position[d]);
+            else if(position[d] > upper)
+                squared_distance += (position[d] - upper) * (position[d] - upper);
+        }
+        // Small margin to be robust to the rounding errors on the bounds of the octant.
+        return squared_distance <= VISION_DISTANCE * VISION_DISTANCE * (1.0f + 1e-5f);
+    }
+
+    /**
+     * (Morton index of the leaf octant, index of the boid) pairs, sorted by Morton index.
+     */
+    std::vector< std::pair<std::size_t, std::size_t> > m_sorted_boids;
+};
+
+#endif //SWARMING_PROJECT_OCTREENEIGHBOURSEARCH_H
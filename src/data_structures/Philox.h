@@ -0,0 +1,100 @@
+#ifndef SWARMING_PROJECT_PHILOX_H
+#define SWARMING_PROJECT_PHILOX_H
+
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <array>
+
+/**
+ * Counter-based pseudo-random generator Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as
+ * 1, 2, 3", SC'11).
+ *
+ * The n-th block of 4 random values of a stream is a pure function of (key, stream, n): there is no state to
+ * share or to advance, so any number of independent and reproducible streams can be created in parallel. In this
+ * project, the key is the seed of the simulation and the stream is the global index of a boid, so the population
+ * generated does not depend on the number of threads or of MPI processes.
+ *
+ * The class satisfies the UniformRandomBitGenerator requirements and can be used with the distributions of
+ * <random>.
+ */
+class Philox4x32 {
+
+public:
+
+    using result_type = std::uint32_t;
+
+    /**
+     * Constructor for the Philox4x32 class.
+     * @param seed   key of the generator, shared by all the streams of a simulation.
+     * @param stream index of the stream, e.g. the global index of the boid being generated.
+     */
+    Philox4x32(std::uint64_t seed, std::uint64_t stream)
+            : m_key{{static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)}},
+              m_counter{{0, 0, static_cast<std::uint32_t>(stream), static_cast<std::uint32_t>(stream >> 32)}},
+              m_block(),
+              m_position{BLOCK_SIZE}
+    {
+    }
+
+    static constexpr result_type min() {
+        return std::numeric_limits<result_type>::min();
+    }
+
+    static constexpr result_type max() {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    /**
+     * @return the next random value of the stream.
+     */
+    result_type operator()() {
+        if(m_position == BLOCK_SIZE) {
+            m_block = generate_block(m_counter, m_key);
+            // The two first words of the counter index the blocks inside the stream.
+            if(++m_counter[0] == 0)
+                ++m_counter[1];
+            m_position = 0;
+        }
+        return m_block[m_position++];
+    }
+
+    /**
+     * Compute one block of 4 random values.
+     * @param counter the counter of the block.
+     * @param key     the key of the generator.
+     * @return the 4 random values associated with (counter, key).
+     */
+    static std::array<std::uint32_t, 4> generate_block(std::array<std::uint32_t, 4> counter,
+                                                       std::array<std::uint32_t, 2> key) {
+        for(std::size_t round{0}; round < NUMBER_OF_ROUNDS; ++round) {
+            if(round > 0) {
+                key[0] += WEYL_0;
+                key[1] += WEYL_1;
+            }
+            std::uint64_t const product_0{static_cast<std::uint64_t>(MULTIPLIER_0) * counter[0]};
+            std::uint64_t const product_1{static_cast<std::uint64_t>(MULTIPLIER_1) * counter[2]};
+            counter = {{static_cast<std::uint32_t>(product_1 >> 32) ^ counter[1] ^ key[0],
+                        static_cast<std::uint32_t>(product_1),
+                        static_cast<std::uint32_t>(product_0 >> 32) ^ counter[3] ^ key[1],
+                        static_cast<std::uint32_t>(product_0)}};
+        }
+        return counter;
+    }
+
+private:
+
+    static constexpr std::size_t   BLOCK_SIZE{4};
+    static constexpr std::size_t   NUMBER_OF_ROUNDS{10};
+    static constexpr std::uint32_t MULTIPLIER_0{0xD2511F53};
+    static constexpr std::uint32_t MULTIPLIER_1{0xCD9E8D57};
+    static constexpr std::uint32_t WEYL_0{0x9E3779B9};
+    static constexpr std::uint32_t WEYL_1{0xBB67AE85};
+
+    std::array<std::uint32_t, 2> m_key;
+    std::array<std::uint32_t, 4> m_counter;
+    std::array<std::uint32_t, 4> m_block;
+    std::size_t                  m_position;
+};
+
+#endif //SWARMING_PROJECT_PHILOX_H
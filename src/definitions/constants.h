@@ -4,6 +4,10 @@
 #define SWARMING_DO_ALL_CHECKS 1
 #define SWARMING_SORT_USE_TIMER 0
 
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
 namespace constants {
 
     constexpr const double DOUBLE_EPSILON{1e-10};
@@ -16,6 +20,8 @@ namespace constants {
 
     constexpr const float VISION_DISTANCE = 5.0;
     constexpr const float VISION_ANGLE = 120.0; //In degrees
+    // Cosine of VISION_ANGLE, used to test the visibility without computing any angle.
+    const float COS_VISION_ANGLE = static_cast<float>(std::cos(VISION_ANGLE * PI / 180.0));
 
     constexpr const float SEPARATION_MIN_DISTANCE = 1;
     constexpr const float REPULSION_DISTANCE = 1.0;
@@ -25,7 +31,10 @@ namespace constants {
     constexpr const float MAX_SPEED = 1.0;
 
     constexpr const float TIMESTEP = 0.5;
-    constexpr const int   Dmax = 2;
+    constexpr const int   Dmax = 10;
+
+    // Default seed of the generator used to create the boids.
+    constexpr const std::uint64_t DEFAULT_SEED{20180101};
 }
 
 #endif //SWARMING_PROJECT_CONSTANTS_H
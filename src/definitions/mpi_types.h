@@ -0,0 +1,183 @@
+#ifndef SWARMING_PROJECT_MPI_TYPES_H
+#define SWARMING_PROJECT_MPI_TYPES_H
+
+#include <array>
+#include <vector>
+#include <functional>
+#include <type_traits>
+
+#include "mpi.h"
+
+#include "data_structures/MathArray.h"
+
+/**
+ * Mapping of the C++ types to MPI datatypes.
+ *
+ * MPIDatatype<T>::create() builds the datatype describing one T, and MPIDatatype<T>::predefined tells if this
+ * datatype is a predefined MPI datatype, that must not be committed nor freed. The types without specialisation are
+ * sent as opaque blocks of sizeof(T) bytes, so they should be trivially copyable.
+ *
+ * The specialisations for the classes of the project are next to the classes (see Octree.h and Boid.h). Use
+ * mpi_datatype<T>() to get the committed datatype of T.
+ * @tparam T the C++ type.
+ */
+template <typename T, typename Enable = void>
+struct MPIDatatype {
+    static constexpr bool predefined{false};
+
+    static MPI_Datatype create() {
+        MPI_Datatype datatype;
+        MPI_Type_contiguous(sizeof(T), MPI_BYTE, &datatype);
+        return datatype;
+    }
+};
+
+#define SWARMING_MPI_PREDEFINED_DATATYPE(CppType, MpiType)      \
+    template <>                                                  \
+    struct MPIDatatype<CppType> {                                \
+        static constexpr bool predefined{true};                  \
+        static MPI_Datatype create() { return MpiType; }         \
+    };
+
+SWARMING_MPI_PREDEFINED_DATATYPE(char,               MPI_CHAR)
+SWARMING_MPI_PREDEFINED_DATATYPE(signed char,        MPI_SIGNED_CHAR)
+SWARMING_MPI_PREDEFINED_DATATYPE(unsigned char,      MPI_UNSIGNED_CHAR)
+SWARMING_MPI_PREDEFINED_DATATYPE(short,              MPI_SHORT)
+SWARMING_MPI_PREDEFINED_DATATYPE(unsigned short,     MPI_UNSIGNED_SHORT)
+SWARMING_MPI_PREDEFINED_DATATYPE(int,                MPI_INT)
+SWARMING_MPI_PREDEFINED_DATATYPE(unsigned int,       MPI_UNSIGNED)
+SWARMING_MPI_PREDEFINED_DATATYPE(long,               MPI_LONG)
+SWARMING_MPI_PREDEFINED_DATATYPE(unsigned long,      MPI_UNSIGNED_LONG)
+SWARMING_MPI_PREDEFINED_DATATYPE(long long,          MPI_LONG_LONG)
+SWARMING_MPI_PREDEFINED_DATATYPE(unsigned long long, MPI_UNSIGNED_LONG_LONG)
+SWARMING_MPI_PREDEFINED_DATATYPE(float,              MPI_FLOAT)
+SWARMING_MPI_PREDEFINED_DATATYPE(double,             MPI_DOUBLE)
+SWARMING_MPI_PREDEFINED_DATATYPE(long double,        MPI_LONG_DOUBLE)
+SWARMING_MPI_PREDEFINED_DATATYPE(bool,               MPI_CXX_BOOL)
+
+#undef SWARMING_MPI_PREDEFINED_DATATYPE
+
+/**
+ * Get the committed MPI datatype of a C++ type. The datatype is created at the first call, which should be done
+ * after MPI_Init, and is kept until the end of the program.
+ * @tparam T the C++ type.
+ * @return the datatype describing one T.
+ */
+template <typename T>
+MPI_Datatype mpi_datatype() {
+    static MPI_Datatype const datatype = [] {
+        MPI_Datatype created{MPIDatatype<T>::create()};
+        if(!MPIDatatype<T>::predefined)
+            MPI_Type_commit(&created);
+        return created;
+    }();
+    return datatype;
+}
+
+/**
+ * Build the datatype of an object from the datatypes of its members.
+ *
+ * The extent of the datatype is the size of the object, so that contiguous arrays of objects can be sent.
+ * @tparam T type of the object.
+ * @param object    an object of type T, used to compute the displacements of the members.
+ * @param addresses the addresses of the members of @a object.
+ * @param lengths   the number of elements of each member.
+ * @param types     the datatype of the elements of each member.
+ * @return the datatype, not committed.
+ */
+template <typename T>
+MPI_Datatype create_struct_datatype(T const & object, std::vector<void const *> const & addresses,
+                                    std::vector<int> const & lengths, std::vector<MPI_Datatype> const & types) {
+    MPI_Aint base;
+    MPI_Get_address(&object, &base);
+    std::vector<MPI_Aint> displacements(addresses.size());
+    for(std::size_t i{0}; i < addresses.size(); ++i) {
+        MPI_Get_address(addresses[i], &displacements[i]);
+        displacements[i] -= base;
+    }
+
+    MPI_Datatype structure, resized;
+    MPI_Type_create_struct(static_cast<int>(addresses.size()), lengths.data(), displacements.data(), types.data(),
+                           &structure);
+    MPI_Type_create_resized(structure, 0, static_cast<MPI_Aint>(sizeof(T)), &resized);
+    MPI_Type_free(&structure);
+    return resized;
+}
+
+/**
+ * The arrays are sent as blocks of elements of the datatype of their elements.
+ */
+template <typename T, std::size_t Size>
+struct MPIDatatype< std::array<T, Size> > {
+    static constexpr bool predefined{false};
+
+    static MPI_Datatype create() {
+        std::array<T, Size> const array{};
+        return create_struct_datatype(array, {array.data()}, {static_cast<int>(Size)}, {mpi_datatype<T>()});
+    }
+};
+
+template <typename T, std::size_t Size>
+struct MPIDatatype< MathArray<T, Size> > {
+    static constexpr bool predefined{false};
+
+    static MPI_Datatype create() {
+        MathArray<T, Size> const array(T{0});
+        return create_struct_datatype(array, {array.data()}, {static_cast<int>(Size)}, {mpi_datatype<T>()});
+    }
+};
+
+/**
+ * Mapping of a binary operation on a C++ type to an MPI reduction operation.
+ *
+ * The operations without specialisation are applied element by element by a user-defined MPI operation, which
+ * supposes that the operation is associative and commutative. The sums and products of arithmetic types use the
+ * predefined MPI_SUM and MPI_PROD. Use mpi_operation<T, BinaryOperation>() to get the MPI operation.
+ * @tparam T               type of the reduced values.
+ * @tparam BinaryOperation function object computing the operation on two T, e.g. std::plus<T>.
+ */
+template <typename T, typename BinaryOperation, typename Enable = void>
+struct MPIOperation {
+    static constexpr bool predefined{false};
+
+    static void apply(void * input, void * input_output, int * length, MPI_Datatype *) {
+        T const * const lhs{static_cast<T const *>(input)};
+        T       * const rhs{static_cast<T *>(input_output)};
+        BinaryOperation const operation{};
+        for(int i{0}; i < *length; ++i)
+            rhs[i] = operation(lhs[i], rhs[i]);
+    }
+
+    static MPI_Op create() {
+        MPI_Op operation;
+        MPI_Op_create(&apply, /*commute*/ 1, &operation);
+        return operation;
+    }
+};
+
+template <typename T>
+struct MPIOperation<T, std::plus<T>, typename std::enable_if<std::is_arithmetic<T>::value>::type> {
+    static constexpr bool predefined{true};
+    static MPI_Op create() { return MPI_SUM; }
+};
+
+template <typename T>
+struct MPIOperation<T, std::multiplies<T>, typename std::enable_if<std::is_arithmetic<T>::value>::type> {
+    static constexpr bool predefined{true};
+    static MPI_Op create() { return MPI_PROD; }
+};
+
+/**
+ * Get the MPI reduction operation computing a binary operation on a C++ type. The operation is created at the first
+ * call, which should be done after MPI_Init, and is kept until the end of the program.
+ * @tparam T               type of the reduced values.
+ * @tparam BinaryOperation function object computing the operation on two T.
+ * @return the MPI operation, to use with the datatype mpi_datatype<T>().
+ */
+template <typename T, typename BinaryOperation = std::plus<T>>
+MPI_Op mpi_operation() {
+    static MPI_Op const operation{MPIOperation<T, BinaryOperation>::create()};
+    return operation;
+}
+
+#endif //SWARMING_PROJECT_MPI_TYPES_H
@@ -1,18 +1,77 @@
 #include <iostream>
 #include <random>
+#include <vector>
+#include <string>
+#include <cstdlib>
 
 #include "mpi.h"
 #include "algorithms/sample_sort.h"
+#include "algorithms/is_sorted_distributed.h"
 
+/*
+ * Benchmark of the strategies used by sample_sort_inplace to exchange the buckets and to select the splitters: each
+ * strategy sorts the same random arrays several times, and the time of the slowest process is reported. The
+ * imbalance is the size of the largest sorted array divided by the mean size.
+ *
+ * Usage: mpirun -np P ./main SIZE [REPETITIONS]
+ */
 
-template <typename T>
-static std::ostream & operator<<(std::ostream& os, std::vector<T> const & vec) {
-    os << vec.size() << "{";
-    for(std::size_t i{0}; i < vec.size()-1; ++i) {
-        os << vec[i] << ",";
+static char const * to_string(BucketExchange bucket_exchange) {
+    switch(bucket_exchange) {
+        case BucketExchange::POINT_TO_POINT: return "point_to_point";
+        case BucketExchange::IALLTOALLV:     return "ialltoallv";
+        case BucketExchange::ALLTOALLV:
+        default:                             return "alltoallv";
+    }
+}
+
+static char const * to_string(SplitterSelection splitter_selection) {
+    switch(splitter_selection) {
+        case SplitterSelection::GATHER:    return "gather";
+        case SplitterSelection::ALLGATHER: return "allgather";
+        case SplitterSelection::HISTOGRAM:
+        default:                           return "histogram";
+    }
+}
+
+/**
+ * Sort copies of the values several times and print the mean time of the slowest process and the imbalance.
+ * @param name        name of the strategy tested.
+ * @param values      the local values to sort.
+ * @param parameters  the parameters of the sort.
+ * @param repetitions the number of sorts.
+ */
+static void benchmark(std::string const & name, std::vector<unsigned long long> const & values,
+                      SampleSortParameters const & parameters, std::size_t repetitions) {
+    int process_number, process_ID;
+    MPI_Comm_size(MPI_COMM_WORLD, &process_number);
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_ID);
+
+    double total_time{0.0};
+    bool sorted{true};
+    unsigned long long largest_size{0}, total_size{0};
+    for(std::size_t repetition{0}; repetition < repetitions; ++repetition) {
+        std::vector<unsigned long long> array(values);
+        MPI_Barrier(MPI_COMM_WORLD);
+        double const start{MPI_Wtime()};
+        sample_sort_inplace(array, std::less<unsigned long long>(), parameters);
+        double const local_time{MPI_Wtime() - start};
+
+        double time;
+        MPI_Allreduce(&local_time, &time, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        total_time += time;
+        sorted = sorted && is_sorted_distributed(array);
+
+        unsigned long long const size{array.size()};
+        MPI_Allreduce(&size, &largest_size, 1, MPI_UNSIGNED_LONG_LONG, MPI_MAX, MPI_COMM_WORLD);
+        MPI_Allreduce(&size, &total_size, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    }
+
+    if(process_ID == 0) {
+        std::cout << name << ": " << 1000.0 * total_time / repetitions << " ms, imbalance "
+                  << static_cast<double>(largest_size) * process_number / total_size
+                  << (sorted ? "" : " (NOT SORTED)") << std::endl;
     }
-    os << vec.back() << "}" << std::endl;
-    return os;
 }
 
 int main ( int argc , char** argv )
@@ -30,45 +89,44 @@ int main ( int argc , char** argv )
 	MPI_Comm_rank(MPI_COMM_WORLD, &process_ID);
 
     const std::size_t SIZE{std::strtoull(argv[1], nullptr, 10)};
-    constexpr const std::size_t MAX_INT{100};
-    constexpr const bool display{true};
-
-    // Initialise the values on the processor.
-    std::vector<int> values;
-    std::random_device d;
-    std::default_random_engine generator(d());
-    std::uniform_int_distribution<> distribution(0, MAX_INT);
+    const std::size_t REPETITIONS{argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 5};
+
+    // Initialise the values on the processor. The generator is seeded with the process ID so that all the
+    // strategies sort the same arrays.
+    std::vector<unsigned long long> values;
+    std::default_random_engine generator(static_cast<unsigned>(process_ID));
+    std::uniform_int_distribution<unsigned long long> distribution;
     values.reserve(SIZE);
     for(std::size_t i{0}; i < SIZE; ++i) {
         values.push_back(distribution(generator));
     }
 
-    distributed_sort(values, process_number, process_ID);
+    for(BucketExchange bucket_exchange : {BucketExchange::POINT_TO_POINT, BucketExchange::ALLTOALLV,
+                                          BucketExchange::IALLTOALLV}) {
+        SampleSortParameters parameters;
+        parameters.bucket_exchange = bucket_exchange;
+        benchmark(std::string("bucket exchange ") + to_string(bucket_exchange), values, parameters, REPETITIONS);
+    }
 
-    // Output the values 
-    // Here, the first process gather all the values and output them.
-    if(display) {
-        MPI_Barrier(MPI_COMM_WORLD);
-        if(process_ID == 0) {
-            std::cout << "Hi! The processor n°" << process_ID << " have " << values.size() << " values in [" << values.front() << "," << values.back() << "]." << std::endl;
-            for(std::size_t p{1}; p < process_number; ++p) {
-                std::size_t size_to_receive;
-                MPI_Recv(&size_to_receive, 1, MPI_UNSIGNED_LONG_LONG, p, /*tag*/ 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                // Resize the vector that will receive the data.
-                values.resize(size_to_receive);
-                // Then receive the values
-                MPI_Recv(values.data(), size_to_receive, MPI_INT, p, /*tag*/ 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                std::cout << "Hi! The processor n°" << p << " have " << values.size() << " values in [" << values.front() << "," << values.back() << "]." << std::endl;
-            }
-        }
-        else {
-            const std::size_t size_to_send{values.size()};
-            MPI_Send(&size_to_send, 1, MPI_UNSIGNED_LONG_LONG, 0, /*tag*/ 0, MPI_COMM_WORLD);
-            MPI_Send(values.data(), size_to_send, MPI_INT, 0, /*tag*/ 0, MPI_COMM_WORLD);
-        }
-        MPI_Barrier(MPI_COMM_WORLD);
+    // Skewed values, as the Morton indices of clustered boids: most of the values are small.
+    std::vector<unsigned long long> skewed_values;
+    std::exponential_distribution<double> exponential_distribution(1.0);
+    skewed_values.reserve(SIZE);
+    for(std::size_t i{0}; i < SIZE; ++i) {
+        double const x{exponential_distribution(generator)};
+        skewed_values.push_back(static_cast<unsigned long long>(x * x * x * 1e6));
     }
-    
+
+    for(SplitterSelection splitter_selection : {SplitterSelection::GATHER, SplitterSelection::ALLGATHER,
+                                                SplitterSelection::HISTOGRAM}) {
+        SampleSortParameters parameters;
+        parameters.splitter_selection = splitter_selection;
+        benchmark(std::string("splitter selection ") + to_string(splitter_selection), values, parameters,
+                  REPETITIONS);
+        benchmark(std::string("splitter selection ") + to_string(splitter_selection) + " (skewed)", skewed_values,
+                  parameters, REPETITIONS);
+    }
+
 	MPI_Finalize();
 
 	return 0;
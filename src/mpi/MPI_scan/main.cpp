@@ -1,36 +1,82 @@
 #include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <string>
+#include <omp.h>
 
 #include "mpi.h"
 #include "algorithms/distributed_scan.h"
 
-int main ( int argc , char** argv )
-{
-	MPI_Init(&argc,  &argv);
+/*
+ * Benchmark of distributed_scan_inplace: each process scans SIZE values with 1 thread, then with all the threads,
+ * and the time of the slowest process is reported with the throughput per process. The values are i + 1 on all the
+ * processes, so the result can be checked against the closed form.
+ *
+ * Usage: mpirun -np P ./main [SIZE] [REPETITIONS]
+ */
+
+/**
+ * Scan the values several times and print the mean time of the slowest process.
+ * @param name              name of the configuration tested.
+ * @param values            buffer of the values scanned, reinitialised before each scan.
+ * @param number_of_threads the number of threads used by the scan.
+ * @param repetitions       the number of scans.
+ */
+static void benchmark(std::string const & name, std::vector<unsigned long long> & values, int number_of_threads,
+                      std::size_t repetitions) {
     int process_number, process_ID;
+    MPI_Comm_size(MPI_COMM_WORLD, &process_number);
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_ID);
+    unsigned long long const size{values.size()};
 
-    constexpr const std::size_t SIZE{100000000};
-    constexpr const bool display{false};
+    double total_time{0.0};
+    bool correct{true};
+    for(std::size_t repetition{0}; repetition < repetitions; ++repetition) {
+        #pragma omp parallel for num_threads(number_of_threads) schedule(static)
+        for(std::size_t i = 0; i < values.size(); ++i)
+            values[i] = i + 1;
 
-    MPI_Comm_size(MPI_COMM_WORLD, &process_number);
-	MPI_Comm_rank(MPI_COMM_WORLD, &process_ID);
+        MPI_Barrier(MPI_COMM_WORLD);
+        double const start{MPI_Wtime()};
+        distributed_scan_inplace(values.data(), values.size(), number_of_threads);
+        double const local_time{MPI_Wtime() - start};
 
-    // Initialise the values on the processor.
-    std::size_t * values = new std::size_t[SIZE];
-    for(std::size_t i{0}; i < SIZE; ++i) {
-        values[i] = SIZE*process_ID + i;
+        double time;
+        MPI_Reduce(&local_time, &time, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+        total_time += time;
+
+        // The values before the process sum to process_ID * size * (size + 1) / 2.
+        unsigned long long const offset{process_ID * (size * (size + 1) / 2)};
+        for(std::size_t i : {std::size_t{0}, values.size() / 2, values.size() - 1})
+            correct = correct && (values.empty() || values[i] == offset + (i + 1) * (i + 2) / 2);
     }
 
-    distributed_prefix(values, SIZE, process_number, process_ID);
-    
-    // Output the values on each processor.
-    if(display) {
-        std::cout << "Hi! I'm processor n°" << process_ID << " and I have the values {";
-        for(std::size_t i{0}; i < SIZE-1; ++i) {
-            std::cout << values[i] << ",";
-        }
-        std::cout << values[SIZE-1] << "}" << std::endl;
+    bool all_correct;
+    MPI_Reduce(&correct, &all_correct, 1, MPI_CXX_BOOL, MPI_LAND, 0, MPI_COMM_WORLD);
+    if(process_ID == 0) {
+        double const mean_time{total_time / repetitions};
+        std::cout << name << ": " << 1e3 * mean_time << " ms, " << size / mean_time / 1e6
+                  << " Melements/s per process" << (all_correct ? "" : " (WRONG RESULT)") << std::endl;
     }
-    
-	MPI_Finalize();
-	return 0;
+}
+
+int main(int argc, char ** argv)
+{
+    MPI_Init(&argc, &argv);
+    std::size_t const size{argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000000};
+    std::size_t const repetitions{argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 5};
+
+    int process_number, process_ID;
+    MPI_Comm_size(MPI_COMM_WORLD, &process_number);
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_ID);
+    if(process_ID == 0)
+        std::cout << process_number << " processes, " << size << " values per process" << std::endl;
+
+    std::vector<unsigned long long> values(size);
+    benchmark("1 thread", values, 1, repetitions);
+    if(omp_get_max_threads() > 1)
+        benchmark(std::to_string(omp_get_max_threads()) + " threads", values, omp_get_max_threads(), repetitions);
+
+    MPI_Finalize();
+    return 0;
 }